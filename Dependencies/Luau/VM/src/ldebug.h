@@ -12,6 +12,7 @@
 
 #define LUA_MEMERRMSG "not enough memory"
 #define LUA_ERRERRMSG "error in error handling"
+#define LUA_YIELDERRMSG "attempt to yield across metamethod/C-call boundary"
 
 LUAI_FUNC l_noret luaG_typeerrorL(lua_State* L, const TValue* o, const char* opname);
 LUAI_FUNC l_noret luaG_forerrorL(lua_State* L, const TValue* o, const char* what);
@@ -616,7 +616,7 @@ int lua_resumeerror(lua_State* L, lua_State* from)
 int lua_yield(lua_State* L, int nresults)
 {
     if (L->nCcalls > L->baseCcalls)
-        luaG_runerror(L, "attempt to yield across metamethod/C-call boundary");
+        luaG_runerror(L, LUA_YIELDERRMSG);
     L->base = L->top - nresults; // protect stack slots below
     L->status = LUA_YIELD;
     return -1;
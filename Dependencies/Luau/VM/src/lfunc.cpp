@@ -6,17 +6,6 @@
 #include "lmem.h"
 #include "lgc.h"
 
-std::map<Closure*, bool> ClosureMap;
-std::map<Closure*, bool> GetClosureList()
-{
-    return ClosureMap;
-}
-
-void ClearClosureList()
-{
-    ClosureMap.clear();
-}
-
 Proto* luaF_newproto(lua_State* L)
 {
     Proto* f = luaM_newgco(L, Proto, sizeof(Proto), L->activememcat);
@@ -75,12 +64,11 @@ Closure* luaF_newLclosure(lua_State* L, int nelems, LuaTable* e, Proto* p)
     c->nupvalues = cast_byte(nelems);
     c->stacksize = p->maxstacksize;
     c->preload = 0;
+    c->isexecutor = 1;
     c->l.p = p;
     for (int i = 0; i < nelems; ++i)
         setnilvalue(&c->l.uprefs[i]);
 
-    ClosureMap.insert(std::pair<Closure*, bool>{ c, true });
-
     //PatchCFG((uintptr_t)c);
     //RBX::Print(1, "Patched a closure created by luaF_newLclosure");
     return c;
@@ -95,12 +83,11 @@ Closure* luaF_newCclosure(lua_State* L, int nelems, LuaTable* e)
     c->nupvalues = cast_byte(nelems);
     c->stacksize = LUA_MINSTACK;
     c->preload = 0;
+    c->isexecutor = 1;
     c->c.f = NULL;
     c->c.cont = NULL;
     c->c.debugname = NULL;
 
-    ClosureMap.insert(std::pair<Closure*, bool>{ c, true });
-
     //PatchCFG((uintptr_t)c);
     //RBX::Print(1, "Patched a closure created by luaF_newCclosure");
     return c;
@@ -204,6 +191,7 @@ void luaF_freeproto(lua_State* L, Proto* f, lua_Page* page)
 void luaF_freeclosure(lua_State* L, Closure* c, lua_Page* page)
 {
     int size = c->isC ? sizeCclosure(c->nupvalues) : sizeLclosure(c->nupvalues);
+    c->isexecutor = 0;
     luaM_freegco(L, c, size, c->memcat, page);
 }
 
@@ -229,4 +217,43 @@ const LocVar* luaF_findlocal(const Proto* f, int local_reg, int pc)
             return &f->locvars[i];
 
     return NULL; // not found
-}
\ No newline at end of file
+}
+
+bool luaF_isexecutorclosure(const void* p)
+{
+    const GCObject* o = cast_to(const GCObject*, p);
+    return o && o->gch.tt == LUA_TFUNCTION && isexecutorcl(&o->cl);
+}
+
+void luaF_opencursor(lua_State* L, ClosureCursor* cur)
+{
+    cur->page = L->global->allgcopages;
+    cur->pos = NULL;
+    cur->end = NULL;
+    cur->blocksize = 0;
+}
+
+Closure* luaF_nextexecutorclosure(lua_State* L, ClosureCursor* cur)
+{
+    global_State* g = L->global;
+
+    for (;;)
+    {
+        while (cur->pos != cur->end)
+        {
+            GCObject* o = cast_to(GCObject*, cur->pos);
+            cur->pos += cur->blocksize;
+
+            // freed blocks have their type reset to nil
+            if (o->gch.tt == LUA_TFUNCTION && !isdead(g, o) && isexecutorcl(gco2cl(o)))
+                return gco2cl(o);
+        }
+
+        if (!cur->page)
+            return NULL;
+
+        int busyBlocks;
+        luaM_getpagewalkinfo(cur->page, &cur->pos, &cur->end, &busyBlocks, &cur->blocksize);
+        cur->page = luaM_getnextpage(cur->page);
+    }
+}
@@ -3,13 +3,20 @@
 #pragma once
 
 #include "lobject.h"
-#include <map>
 
 #define sizeCclosure(n) (offsetof(Closure, c.upvals) + sizeof(TValue) * (n))
 #define sizeLclosure(n) (offsetof(Closure, l.uprefs) + sizeof(TValue) * (n))
 
-LUAI_FUNC std::map<Closure*, bool> GetClosureList();
-LUAI_FUNC void ClearClosureList();
+#define isexecutorcl(c) ((c)->isexecutor != 0)
+
+// walks GC pages in place; only valid while no allocation or GC step happens between calls
+typedef struct ClosureCursor
+{
+    struct lua_Page* page;
+    char* pos;
+    char* end;
+    int blocksize;
+} ClosureCursor;
 
 LUAI_FUNC Proto* luaF_newproto(lua_State* L);
 LUAI_FUNC Closure* luaF_newLclosure(lua_State* L, int nelems, LuaTable* e, Proto* p);
@@ -22,3 +29,7 @@ LUAI_FUNC void luaF_freeclosure(lua_State* L, Closure* c, struct lua_Page* page)
 LUAI_FUNC void luaF_freeupval(lua_State* L, UpVal* uv, struct lua_Page* page);
 LUAI_FUNC const LocVar* luaF_getlocal(const Proto* func, int local_number, int pc);
 LUAI_FUNC const LocVar* luaF_findlocal(const Proto* func, int local_reg, int pc);
+
+LUAI_FUNC bool luaF_isexecutorclosure(const void* p);
+LUAI_FUNC void luaF_opencursor(lua_State* L, ClosureCursor* cur);
+LUAI_FUNC Closure* luaF_nextexecutorclosure(lua_State* L, ClosureCursor* cur);
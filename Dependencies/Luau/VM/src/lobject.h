@@ -382,6 +382,7 @@ typedef struct Closure
     uint8_t nupvalues;
     uint8_t stacksize;
     uint8_t preload;
+    uint8_t isexecutor; // created through luaF_newLclosure/luaF_newCclosure; lives in header padding
 
     GCObject* gclist;
     struct LuaTable* env;
@@ -60,6 +60,7 @@ static void f_luaopen(lua_State* L, void* ud)
     luaT_init(L);
     luaS_fix(luaS_newliteral(L, LUA_MEMERRMSG)); // pin to make sure we can always throw this error
     luaS_fix(luaS_newliteral(L, LUA_ERRERRMSG)); // pin to make sure we can always throw this error
+    luaS_fix(luaS_newliteral(L, LUA_YIELDERRMSG)); // pin so hosts can identify it by identity without allocating
     g->GCthreshold = 4 * g->totalbytes;
 }
 
@@ -216,6 +217,7 @@ lua_State* lua_newstate(lua_Alloc f, void* ud)
     }
     for (i = 0; i < LUA_LUTAG_LIMIT; i++)
         g->lightuserdataname[i] = NULL;
+    g->patterncache = NULL;
     for (i = 0; i < LUA_MEMORY_CATEGORIES; i++)
         g->memcatbytes[i] = 0;
 
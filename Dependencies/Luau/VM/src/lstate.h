@@ -221,6 +221,8 @@ typedef struct global_State
 
     TString* lightuserdataname[LUA_LUTAG_LIMIT]; // names for tagged lightuserdata
 
+    struct lua_PatternCache* patterncache; // compiled string patterns, owned by a registry userdata (see lstrlib.cpp)
+
     GCStats gcstats;
 
 #ifdef LUAI_GCMETRICS
@@ -3,11 +3,43 @@
 #include "lualib.h"
 
 #include "lstring.h"
+#include "lgc.h"
+#include "ldo.h"
 
 #include <ctype.h>
 #include <string.h>
 #include <stdio.h>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#define LUAU_STRLIB_SIMD 1
+
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+// SSE2 is part of x86-64; AVX2 code is picked at startup when the CPU and OS support it
+#if defined(__AVX2__) || (defined(_MSC_VER) && !defined(__clang__))
+#define LUAU_TARGET_AVX2
+#else
+#define LUAU_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+static int lmemfind_ctz(unsigned int mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return int(index);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+#endif
+
 // macro to `unsign' a character
 #define uchar(c) ((unsigned char)(c))
 
@@ -44,15 +76,97 @@ static int str_sub(lua_State* L)
     return 1;
 }
 
+// A result string of known length, filled by the caller before push_result. Short results go through a stack buffer and
+// are interned from there; long ones are written straight into the string object, as luaV_concat does. Nothing may
+// allocate between start_result and push_result, since the unfinished string isn't reachable by the GC.
+typedef struct StrResult
+{
+    char buffer[LUA_BUFFERSIZE];
+    TString* ts;
+    size_t len;
+} StrResult;
+
+static char* start_result(lua_State* L, StrResult* r, size_t len)
+{
+    r->len = len;
+    if (len < LUA_BUFFERSIZE)
+    {
+        r->ts = NULL;
+        return r->buffer;
+    }
+
+    luaC_checkGC(L);
+    r->ts = luaS_bufstart(L, len);
+    return r->ts->data;
+}
+
+static void push_result(lua_State* L, StrResult* r)
+{
+    if (r->ts)
+    {
+        setsvalue(L, L->top, luaS_buffinish(L, r->ts));
+        incr_top(L);
+    }
+    else
+    {
+        lua_pushlstring(L, r->buffer, r->len);
+    }
+}
+
+static void reversebytes(char* d, const char* s, size_t l)
+{
+    size_t i = 0;
+#ifdef LUAU_STRLIB_SIMD
+    for (; i + 16 <= l; i += 16)
+    {
+        // reverse the dwords, then the words in each dword, then the bytes in each word
+        __m128i x = _mm_loadu_si128((const __m128i*)(s + l - i - 16));
+        x = _mm_shuffle_epi32(x, _MM_SHUFFLE(0, 1, 2, 3));
+        x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+        x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+        x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+        _mm_storeu_si128((__m128i*)(d + i), x);
+    }
+#endif
+    for (; i < l; i++)
+        d[i] = s[l - 1 - i];
+}
+
+// ASCII letters are mapped 16 at a time, assuming they map as in the C locale (the host never calls setlocale); bytes
+// over 0x7f in a block are then redone one by one through tolower/toupper, which decide what the locale does with them.
+static void mapcase(char* d, const char* s, size_t l, bool upper)
+{
+    size_t i = 0;
+#ifdef LUAU_STRLIB_SIMD
+    const __m128i first = _mm_set1_epi8(upper ? 'a' - 1 : 'A' - 1);
+    const __m128i last = _mm_set1_epi8(upper ? 'z' + 1 : 'Z' + 1);
+    const __m128i flip = _mm_set1_epi8(0x20);
+
+    for (; i + 16 <= l; i += 16)
+    {
+        // bytes over 0x7f compare as negative, so they are never taken for letters here
+        __m128i x = _mm_loadu_si128((const __m128i*)(s + i));
+        __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(x, first), _mm_cmplt_epi8(x, last));
+        _mm_storeu_si128((__m128i*)(d + i), _mm_xor_si128(x, _mm_and_si128(letters, flip)));
+
+        for (unsigned int high = unsigned(_mm_movemask_epi8(x)); high; high &= high - 1)
+        {
+            size_t j = i + lmemfind_ctz(high);
+            d[j] = char(upper ? toupper(uchar(s[j])) : tolower(uchar(s[j])));
+        }
+    }
+#endif
+    for (; i < l; i++)
+        d[i] = char(upper ? toupper(uchar(s[i])) : tolower(uchar(s[i])));
+}
+
 static int str_reverse(lua_State* L)
 {
     size_t l;
     const char* s = luaL_checklstring(L, 1, &l);
-    luaL_Strbuf b;
-    char* ptr = luaL_buffinitsize(L, &b, l);
-    while (l--)
-        *ptr++ = s[l];
-    luaL_pushresultsize(&b, ptr - b.p);
+    StrResult r;
+    reversebytes(start_result(L, &r, l), s, l);
+    push_result(L, &r);
     return 1;
 }
 
@@ -60,11 +174,9 @@ static int str_lower(lua_State* L)
 {
     size_t l;
     const char* s = luaL_checklstring(L, 1, &l);
-    luaL_Strbuf b;
-    char* ptr = luaL_buffinitsize(L, &b, l);
-    for (size_t i = 0; i < l; i++)
-        *ptr++ = tolower(uchar(s[i]));
-    luaL_pushresultsize(&b, l);
+    StrResult r;
+    mapcase(start_result(L, &r, l), s, l, false);
+    push_result(L, &r);
     return 1;
 }
 
@@ -72,11 +184,9 @@ static int str_upper(lua_State* L)
 {
     size_t l;
     const char* s = luaL_checklstring(L, 1, &l);
-    luaL_Strbuf b;
-    char* ptr = luaL_buffinitsize(L, &b, l);
-    for (size_t i = 0; i < l; i++)
-        *ptr++ = toupper(uchar(s[i]));
-    luaL_pushresultsize(&b, l);
+    StrResult r;
+    mapcase(start_result(L, &r, l), s, l, true);
+    push_result(L, &r);
     return 1;
 }
 
@@ -95,8 +205,15 @@ static int str_rep(lua_State* L)
     if (l > MAXSSIZE / (size_t)n) // may overflow?
         luaL_error(L, "resulting string too large");
 
-    luaL_Strbuf b;
-    char* ptr = luaL_buffinitsize(L, &b, l * n);
+    StrResult r;
+    char* ptr = start_result(L, &r, l * n);
+
+    if (l == 1)
+    {
+        memset(ptr, s[0], n);
+        push_result(L, &r);
+        return 1;
+    }
 
     const char* start = ptr;
 
@@ -120,7 +237,7 @@ static int str_rep(lua_State* L)
     memcpy(ptr, start, left);
     ptr += left;
 
-    luaL_pushresultsize(&b, l * n);
+    push_result(L, &r);
 
     return 1;
 }
@@ -575,7 +692,7 @@ init: // using goto's to optimize tail recursion
     return s;
 }
 
-static const char* lmemfind(const char* s1, size_t l1, const char* s2, size_t l2)
+static const char* lmemfind_scalar(const char* s1, size_t l1, const char* s2, size_t l2)
 {
     if (l2 == 0)
         return s1; // empty strings are everywhere
@@ -601,6 +718,720 @@ static const char* lmemfind(const char* s1, size_t l1, const char* s2, size_t l2
     }
 }
 
+#ifdef LUAU_STRLIB_SIMD
+// Both searches compare a block of candidate positions at once against the first and the last byte of the needle, and
+// only compare the middle of the needle at positions where both match. Unlike filtering on the first byte alone, this
+// stays fast when that byte is common in the haystack (spaces, quotes, separators). Requires 2 <= l2 <= l1; positions
+// past the last full block are left to the scalar search.
+static const char* lmemfind_sse2(const char* s1, size_t l1, const char* s2, size_t l2)
+{
+    const __m128i first = _mm_set1_epi8(s2[0]);
+    const __m128i last = _mm_set1_epi8(s2[l2 - 1]);
+    size_t positions = l1 - l2 + 1;
+    size_t i = 0;
+
+    for (; i + 16 <= positions; i += 16)
+    {
+        __m128i blockfirst = _mm_loadu_si128((const __m128i*)(s1 + i));
+        __m128i blocklast = _mm_loadu_si128((const __m128i*)(s1 + i + l2 - 1));
+        unsigned int mask = unsigned(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(blockfirst, first), _mm_cmpeq_epi8(blocklast, last))));
+
+        while (mask)
+        {
+            size_t pos = i + lmemfind_ctz(mask);
+            if (memcmp(s1 + pos + 1, s2 + 1, l2 - 2) == 0)
+                return s1 + pos;
+            mask &= mask - 1;
+        }
+    }
+
+    return lmemfind_scalar(s1 + i, l1 - i, s2, l2);
+}
+
+LUAU_TARGET_AVX2 static const char* lmemfind_avx2(const char* s1, size_t l1, const char* s2, size_t l2)
+{
+    const __m256i first = _mm256_set1_epi8(s2[0]);
+    const __m256i last = _mm256_set1_epi8(s2[l2 - 1]);
+    size_t positions = l1 - l2 + 1;
+    size_t i = 0;
+
+    for (; i + 32 <= positions; i += 32)
+    {
+        __m256i blockfirst = _mm256_loadu_si256((const __m256i*)(s1 + i));
+        __m256i blocklast = _mm256_loadu_si256((const __m256i*)(s1 + i + l2 - 1));
+        unsigned int mask = unsigned(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(blockfirst, first), _mm256_cmpeq_epi8(blocklast, last))));
+
+        while (mask)
+        {
+            size_t pos = i + lmemfind_ctz(mask);
+            if (memcmp(s1 + pos + 1, s2 + 1, l2 - 2) == 0)
+                return s1 + pos;
+            mask &= mask - 1;
+        }
+    }
+
+    // upper-half state is cleared before the SSE2 code takes the remaining positions
+    _mm256_zeroupper();
+    return lmemfind_sse2(s1 + i, l1 - i, s2, l2);
+}
+
+static bool luau_hasavx2()
+{
+    int cpuinfo[4] = {};
+#ifdef _MSC_VER
+    __cpuid(cpuinfo, 1);
+#else
+    __cpuid(1, cpuinfo[0], cpuinfo[1], cpuinfo[2], cpuinfo[3]);
+#endif
+
+    // the OS has to save YMM registers: OSXSAVE and AVX, then XCR0 bits 1 (SSE) and 2 (AVX) set
+    if ((cpuinfo[2] & (1 << 27)) == 0 || (cpuinfo[2] & (1 << 28)) == 0)
+        return false;
+
+#ifdef _MSC_VER
+    unsigned long long xcr0 = _xgetbv(0);
+#else
+    unsigned int xcr0lo, xcr0hi;
+    __asm__("xgetbv" : "=a"(xcr0lo), "=d"(xcr0hi) : "c"(0));
+    unsigned long long xcr0 = xcr0lo | ((unsigned long long)xcr0hi << 32);
+#endif
+    if ((xcr0 & 6) != 6)
+        return false;
+
+#ifdef _MSC_VER
+    __cpuidex(cpuinfo, 7, 0);
+#else
+    __cpuid_count(7, 0, cpuinfo[0], cpuinfo[1], cpuinfo[2], cpuinfo[3]);
+#endif
+
+    // https://en.wikipedia.org/wiki/CPUID#EAX=7,_ECX=0:_Extended_Features
+    return (cpuinfo[1] & (1 << 5)) != 0;
+}
+
+static const bool luau_strlib_avx2 = luau_hasavx2();
+
+static const char* (*const lmemfind_simd)(const char*, size_t, const char*, size_t) = luau_strlib_avx2 ? lmemfind_avx2 : lmemfind_sse2;
+#endif
+
+static const char* lmemfind(const char* s1, size_t l1, const char* s2, size_t l2)
+{
+#ifdef LUAU_STRLIB_SIMD
+    // a single byte is what memchr already does best
+    if (l2 >= 2 && l2 <= l1)
+        return lmemfind_simd(s1, l1, s2, l2);
+#endif
+
+    return lmemfind_scalar(s1, l1, s2, l2);
+}
+
+/*
+** {======================================================
+** Compiled patterns
+** A pattern is parsed once into a list of items, with character classes turned into 256-bit sets, and kept in a small
+** per-state cache keyed by the pattern string. The compiled matcher below mirrors match() item for item, so results,
+** captures and runtime errors are the same; patterns it can't compile (too long, or malformed in a way the interpreter
+** only reports once matching reaches that point) keep using match().
+** =======================================================
+*/
+
+#define PATCACHE_SLOTS 32    // direct-mapped by string hash
+#define PATCACHE_MAXLEN 64   // longer patterns are never compiled
+#define PATCACHE_MAXITEMS 32 // items per compiled pattern
+#define PATCACHE_MAXSETS 8   // distinct character classes per compiled pattern
+
+enum PatternOp
+{
+    PAT_CHAR,     // a literal char, with an optional repetition suffix
+    PAT_SET,      // a class ('.', %a, [...]), with an optional repetition suffix
+    PAT_OPEN,     // '('
+    PAT_POSITION, // '()'
+    PAT_CLOSE,    // ')'
+    PAT_END,      // '$' at the end of the pattern
+    PAT_BALANCE,  // %bxy
+    PAT_FRONTIER, // %f[set]
+    PAT_BACKREF,  // %1-%9 (and %0, which check_capture rejects at runtime)
+};
+
+typedef struct PatternItem
+{
+    uint8_t op;  // PatternOp
+    uint8_t rep; // '*', '+', '-', '?' or 0
+    uint8_t a;   // PAT_CHAR: the char; PAT_SET, PAT_FRONTIER: set index; PAT_BALANCE: open char; PAT_BACKREF: digit
+    uint8_t b;   // PAT_BALANCE: close char
+} PatternItem;
+
+// A set in the form scanset looks bytes up 32 at a time: bit h of nibbles[n] is set when byte (h << 4) | n is in the set,
+// for bytes below 0x80. Bytes above are usually all in (negated classes) or all out.
+enum SetHigh
+{
+    SETHIGH_NONE,
+    SETHIGH_ALL,
+    SETHIGH_MIXED,
+};
+
+typedef struct SetScan
+{
+    uint8_t nibbles[16];
+    uint8_t high; // SetHigh
+} SetScan;
+
+typedef struct CompiledPattern
+{
+    bool compiled; // false when matching has to use match()
+    uint8_t nitems;
+    uint8_t nsets;
+
+    // where a match can start: at an occurrence of prefix, of firstchar, or of a char in set firstset; otherwise anywhere
+    uint8_t prefixlen;
+    int firstchar; // -1 if none
+    int firstset;  // -1 if none
+
+    PatternItem items[PATCACHE_MAXITEMS];
+    uint32_t sets[PATCACHE_MAXSETS][8];
+    SetScan scans[PATCACHE_MAXSETS];
+    char prefix[PATCACHE_MAXLEN];
+} CompiledPattern;
+
+typedef struct PatternCacheSlot
+{
+    int len;  // of the pattern string, -1 when the slot is empty
+    int skip; // chars the caller strips before matching (the '^' anchor)
+    char pattern[PATCACHE_MAXLEN];
+    CompiledPattern compiled;
+} PatternCacheSlot;
+
+struct lua_PatternCache
+{
+    global_State* g;
+    PatternCacheSlot slots[PATCACHE_SLOTS];
+};
+
+static int inset(const uint32_t* set, int c)
+{
+    return (set[c >> 5] >> (c & 31)) & 1;
+}
+
+// classend() for compilation: NULL instead of an error when the class is malformed
+static const char* classend_nothrow(const char* p, const char* p_end)
+{
+    switch (*p++)
+    {
+    case L_ESC:
+        return p == p_end ? NULL : p + 1;
+    case '[':
+    {
+        if (*p == '^')
+            p++;
+        do
+        { // look for a `]'
+            if (p == p_end)
+                return NULL;
+            if (*(p++) == L_ESC && p < p_end)
+                p++; // skip escapes (e.g. `%]')
+        } while (*p != ']');
+        return p + 1;
+    }
+    default:
+        return p;
+    }
+}
+
+// the index of the class [p, ep) in cp's sets, adding it if it is new; -1 when there is no room
+static int compileset(CompiledPattern* cp, const char* p, const char* ep)
+{
+    uint32_t set[8] = {};
+    for (int c = 0; c < 256; c++)
+    {
+        int in = *p == '.' ? 1 : *p == L_ESC ? match_class(c, uchar(*(p + 1))) : matchbracketclass(c, p, ep - 1);
+        if (in)
+            set[c >> 5] |= 1u << (c & 31);
+    }
+
+    for (int i = 0; i < cp->nsets; i++)
+        if (memcmp(cp->sets[i], set, sizeof(set)) == 0)
+            return i;
+
+    if (cp->nsets == PATCACHE_MAXSETS)
+        return -1;
+
+    SetScan* scan = &cp->scans[cp->nsets];
+    memset(scan->nibbles, 0, sizeof(scan->nibbles));
+    int high = 0;
+    for (int c = 0; c < 256; c++)
+    {
+        if (!inset(set, c))
+            continue;
+        if (c < 0x80)
+            scan->nibbles[c & 15] |= uint8_t(1 << (c >> 4));
+        else
+            high++;
+    }
+    scan->high = high == 0 ? SETHIGH_NONE : high == 0x80 ? SETHIGH_ALL : SETHIGH_MIXED;
+
+    memcpy(cp->sets[cp->nsets], set, sizeof(set));
+    return cp->nsets++;
+}
+
+// follows the decisions match() makes at each pattern position
+static bool compileitems(CompiledPattern* cp, const char* p, const char* p_end)
+{
+    cp->nitems = 0;
+    cp->nsets = 0;
+
+    while (p != p_end)
+    {
+        if (cp->nitems == PATCACHE_MAXITEMS)
+            return false;
+
+        PatternItem* item = &cp->items[cp->nitems++];
+        item->rep = 0;
+        item->a = 0;
+        item->b = 0;
+
+        switch (*p)
+        {
+        case '(':
+            item->op = *(p + 1) == ')' ? PAT_POSITION : PAT_OPEN;
+            p += item->op == PAT_POSITION ? 2 : 1;
+            continue;
+        case ')':
+            item->op = PAT_CLOSE;
+            p++;
+            continue;
+        case '$':
+            if ((p + 1) != p_end)
+                break;
+            item->op = PAT_END;
+            p++;
+            continue;
+        case L_ESC:
+            switch (*(p + 1))
+            {
+            case 'b':
+                if (p + 2 >= p_end - 1)
+                    return false;
+                item->op = PAT_BALANCE;
+                item->a = uchar(*(p + 2));
+                item->b = uchar(*(p + 3));
+                p += 4;
+                continue;
+            case 'f':
+            {
+                p += 2;
+                if (*p != '[')
+                    return false;
+                const char* ep = classend_nothrow(p, p_end);
+                int set = ep ? compileset(cp, p, ep) : -1;
+                if (set < 0)
+                    return false;
+                item->op = PAT_FRONTIER;
+                item->a = uint8_t(set);
+                p = ep;
+                continue;
+            }
+            case '0':
+            case '1':
+            case '2':
+            case '3':
+            case '4':
+            case '5':
+            case '6':
+            case '7':
+            case '8':
+            case '9':
+                item->op = PAT_BACKREF;
+                item->a = uchar(*(p + 1));
+                p += 2;
+                continue;
+            default:
+                break;
+            }
+            break;
+        default:
+            break;
+        }
+
+        // pattern class plus optional suffix
+        const char* ep = classend_nothrow(p, p_end);
+        if (!ep)
+            return false;
+
+        // an escaped char that isn't a class letter (%., %%, %-) is a literal, see match_class
+        bool escapedliteral = *p == L_ESC && strchr("acdglpsuwxz", tolower(uchar(*(p + 1)))) == NULL;
+
+        if (*p == '.' || (*p == L_ESC && !escapedliteral) || *p == '[')
+        {
+            int set = compileset(cp, p, ep);
+            if (set < 0)
+                return false;
+            item->op = PAT_SET;
+            item->a = uint8_t(set);
+        }
+        else
+        {
+            item->op = PAT_CHAR;
+            item->a = uchar(escapedliteral ? *(p + 1) : *p);
+        }
+
+        if (*ep == '*' || *ep == '+' || *ep == '-' || *ep == '?')
+        {
+            item->rep = uchar(*ep);
+            p = ep + 1;
+        }
+        else
+        {
+            p = ep;
+        }
+    }
+
+    return true;
+}
+
+static void compilepattern(CompiledPattern* cp, const char* p, const char* p_end)
+{
+    cp->compiled = compileitems(cp, p, p_end);
+    cp->prefixlen = 0;
+    cp->firstchar = -1;
+    cp->firstset = -1;
+
+    if (!cp->compiled)
+        return;
+
+    // captures don't consume anything, so the first item that does decides where a match can start
+    int i = 0;
+    while (i < cp->nitems && (cp->items[i].op == PAT_OPEN || cp->items[i].op == PAT_POSITION))
+        i++;
+
+    for (int j = i; j < cp->nitems && cp->items[j].op == PAT_CHAR && cp->items[j].rep == 0; j++)
+        cp->prefix[cp->prefixlen++] = char(cp->items[j].a);
+
+    if (i < cp->nitems)
+    {
+        const PatternItem* item = &cp->items[i];
+        bool required = item->rep == 0 || item->rep == '+';
+        if ((item->op == PAT_CHAR && required) || item->op == PAT_BALANCE)
+            cp->firstchar = item->a;
+        else if (item->op == PAT_SET && required)
+            cp->firstset = item->a;
+    }
+}
+
+static void freepatterncache(void* ud)
+{
+    lua_PatternCache* cache = (lua_PatternCache*)ud;
+    cache->g->patterncache = NULL;
+}
+
+static lua_PatternCache* newpatterncache(lua_State* L)
+{
+    lua_PatternCache* cache = (lua_PatternCache*)lua_newuserdatadtor(L, sizeof(lua_PatternCache), freepatterncache);
+    cache->g = L->global;
+    for (int i = 0; i < PATCACHE_SLOTS; i++)
+        cache->slots[i].len = -1;
+
+    lua_setfield(L, LUA_REGISTRYINDEX, "_PATTERNCACHE");
+    L->global->patterncache = cache;
+    return cache;
+}
+
+// Copies out the compiled form of the pattern string at idx (p, lp), matched after its first `skip` chars. A copy,
+// since gsub runs Lua code between matches that may reuse the slot. Returns false when match() has to be used.
+static bool getpattern(lua_State* L, int idx, const char* p, size_t lp, int skip, CompiledPattern* result)
+{
+    if (lp > PATCACHE_MAXLEN)
+        return false;
+
+    lua_PatternCache* cache = L->global->patterncache;
+    if (!cache)
+        cache = newpatterncache(L);
+
+    const TString* ts = (const TString*)lua_topointer(L, idx);
+    PatternCacheSlot* slot = &cache->slots[ts->hash & (PATCACHE_SLOTS - 1)];
+
+    if (slot->len != int(lp) || slot->skip != skip || memcmp(slot->pattern, p, lp) != 0)
+    {
+        slot->len = int(lp);
+        slot->skip = skip;
+        memcpy(slot->pattern, p, lp);
+        compilepattern(&slot->compiled, p + skip, p + lp);
+    }
+
+    if (!slot->compiled.compiled)
+        return false;
+
+    *result = slot->compiled;
+    return true;
+}
+
+#ifdef LUAU_STRLIB_SIMD
+LUAU_TARGET_AVX2 static const char* scanset_avx2(const SetScan* scan, const char* s, const char* end, bool member)
+{
+    const __m256i nibbles = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)scan->nibbles));
+    const __m256i rowbits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i low = _mm256_set1_epi8(0x0f);
+    const __m256i zero = _mm256_setzero_si256();
+
+    for (; end - s >= 32; s += 32)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i*)s);
+        // bytes over 0x7f have a high nibble past the 8 rows, so they come out as not in the set
+        __m256i columns = _mm256_shuffle_epi8(nibbles, _mm256_and_si256(x, low));
+        __m256i rows = _mm256_shuffle_epi8(rowbits, _mm256_and_si256(_mm256_srli_epi16(x, 4), low));
+        unsigned int outside = unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(columns, rows), zero)));
+        if (scan->high == SETHIGH_ALL)
+            outside &= ~unsigned(_mm256_movemask_epi8(x));
+
+        unsigned int mask = member ? ~outside : outside;
+        if (mask)
+            return s + lmemfind_ctz(mask);
+    }
+
+    return s;
+}
+#endif
+
+// The first position in [s, end) whose byte is in set (member) or not in it (!member), or end.
+static const char* scanset(const CompiledPattern* cp, int set, const char* s, const char* end, bool member)
+{
+    // most runs (words, gaps between them) end within a few bytes, sooner than the vector loop pays for its setup
+    const char* head = end - s > 16 ? s + 16 : end;
+    for (; s < head; s++)
+        if (bool(inset(cp->sets[set], uchar(*s))) == member)
+            return s;
+
+#ifdef LUAU_STRLIB_SIMD
+    if (luau_strlib_avx2 && cp->scans[set].high != SETHIGH_MIXED)
+        s = scanset_avx2(&cp->scans[set], s, end, member);
+#endif
+    for (; s < end; s++)
+        if (bool(inset(cp->sets[set], uchar(*s))) == member)
+            break;
+    return s;
+}
+
+// The first position in [s, end] where cp can match, or NULL if there is none.
+static const char* nextcandidate(const CompiledPattern* cp, const char* s, const char* end)
+{
+    if (cp->prefixlen >= 2)
+        return lmemfind(s, end - s, cp->prefix, cp->prefixlen);
+    if (cp->firstchar >= 0)
+        return (const char*)memchr(s, cp->firstchar, end - s);
+    if (cp->firstset >= 0)
+    {
+        s = scanset(cp, cp->firstset, s, end, true);
+        return s < end ? s : NULL;
+    }
+    return s;
+}
+
+static const char* cmatch(MatchState* ms, const CompiledPattern* cp, const char* s, int i);
+
+static int csinglematch(MatchState* ms, const CompiledPattern* cp, const char* s, const PatternItem* item)
+{
+    if (s >= ms->src_end)
+        return 0;
+
+    int c = uchar(*s);
+    return item->op == PAT_CHAR ? c == item->a : inset(cp->sets[item->a], c);
+}
+
+static const char* cmatchbalance(MatchState* ms, const char* s, char b, char e)
+{
+    if (*s != b)
+        return NULL;
+
+    int cont = 1;
+    while (++s < ms->src_end)
+    {
+        if (*s == e)
+        {
+            if (--cont == 0)
+                return s + 1;
+        }
+        else if (*s == b)
+            cont++;
+    }
+    return NULL; // string ends out of balance
+}
+
+static const char* cmax_expand(MatchState* ms, const CompiledPattern* cp, const char* s, int i)
+{
+    const PatternItem* item = &cp->items[i];
+    ptrdiff_t n = 0; // counts maximum expand for item
+    if (item->op == PAT_SET)
+        n = scanset(cp, item->a, s, ms->src_end, false) - s;
+    else
+        while (csinglematch(ms, cp, s + n, item))
+            n++;
+
+    // a literal char next fails at once where the string doesn't have it, so only those positions are tried
+    const PatternItem* next = i + 1 < cp->nitems ? &cp->items[i + 1] : NULL;
+    int literal = next && next->op == PAT_CHAR && (next->rep == 0 || next->rep == '+') ? next->a : -1;
+
+    // keeps trying to match with the maximum repetitions
+    while (n >= 0)
+    {
+        if (literal < 0 || (s + n < ms->src_end && uchar(s[n]) == literal))
+        {
+            const char* res = cmatch(ms, cp, s + n, i + 1);
+            if (res)
+                return res;
+        }
+        n--; // else didn't match; reduce 1 repetition to try again
+    }
+    return NULL;
+}
+
+static const char* cmin_expand(MatchState* ms, const CompiledPattern* cp, const char* s, int i)
+{
+    for (;;)
+    {
+        const char* res = cmatch(ms, cp, s, i + 1);
+        if (res != NULL)
+            return res;
+        else if (csinglematch(ms, cp, s, &cp->items[i]))
+            s++; // try with one more repetition
+        else
+            return NULL;
+    }
+}
+
+static const char* cstart_capture(MatchState* ms, const CompiledPattern* cp, const char* s, int i, int what)
+{
+    const char* res;
+    int level = ms->level;
+    if (level >= LUA_MAXCAPTURES)
+        luaL_error(ms->L, "too many captures");
+    ms->capture[level].init = s;
+    ms->capture[level].len = what;
+    ms->level = level + 1;
+    if ((res = cmatch(ms, cp, s, i)) == NULL) // match failed?
+        ms->level--;                          // undo capture
+    return res;
+}
+
+static const char* cend_capture(MatchState* ms, const CompiledPattern* cp, const char* s, int i)
+{
+    int l = capture_to_close(ms);
+    const char* res;
+    ms->capture[l].len = s - ms->capture[l].init; // close capture
+    if ((res = cmatch(ms, cp, s, i)) == NULL)     // match failed?
+        ms->capture[l].len = CAP_UNFINISHED;      // undo capture
+    return res;
+}
+
+// match() over compiled items, starting at item i
+static const char* cmatch(MatchState* ms, const CompiledPattern* cp, const char* s, int i)
+{
+    if (ms->matchdepth-- == 0)
+        luaL_error(ms->L, "pattern too complex");
+
+    lua_State* L = ms->L;
+    void (*interrupt)(lua_State*, int) = L->global->cb.interrupt;
+
+    if (LUAU_UNLIKELY(!!interrupt))
+    {
+        // this interrupt is not yieldable
+        L->nCcalls++;
+        interrupt(L, -1);
+        L->nCcalls--;
+    }
+
+init: // using goto's to optimize tail recursion
+    if (i != cp->nitems)
+    { // end of pattern?
+        const PatternItem* item = &cp->items[i];
+        switch (item->op)
+        {
+        case PAT_OPEN:
+        case PAT_POSITION:
+            s = cstart_capture(ms, cp, s, i + 1, item->op == PAT_POSITION ? CAP_POSITION : CAP_UNFINISHED);
+            break;
+        case PAT_CLOSE:
+            s = cend_capture(ms, cp, s, i + 1);
+            break;
+        case PAT_END:
+            s = (s == ms->src_end) ? s : NULL; // check end of string
+            break;
+        case PAT_BALANCE:
+            s = cmatchbalance(ms, s, char(item->a), char(item->b));
+            if (s != NULL)
+            {
+                i++;
+                goto init;
+            }
+            break;
+        case PAT_FRONTIER:
+        {
+            int previous = (s == ms->src_init) ? 0 : uchar(*(s - 1));
+            if (!inset(cp->sets[item->a], previous) && inset(cp->sets[item->a], uchar(*s)))
+            {
+                i++;
+                goto init;
+            }
+            s = NULL; // match failed
+            break;
+        }
+        case PAT_BACKREF:
+            s = match_capture(ms, s, item->a);
+            if (s != NULL)
+            {
+                i++;
+                goto init;
+            }
+            break;
+        default: // PAT_CHAR, PAT_SET
+            // does not match at least once?
+            if (!csinglematch(ms, cp, s, item))
+            {
+                if (item->rep == '*' || item->rep == '?' || item->rep == '-')
+                { // accept empty?
+                    i++;
+                    goto init;
+                }
+                else          // '+' or no suffix
+                    s = NULL; // fail
+            }
+            else
+            { // matched once
+                switch (item->rep)
+                { // handle optional suffix
+                case '?':
+                { // optional
+                    const char* res;
+                    if ((res = cmatch(ms, cp, s + 1, i + 1)) != NULL)
+                        s = res;
+                    else
+                    {
+                        i++;
+                        goto init;
+                    }
+                    break;
+                }
+                case '+':             // 1 or more repetitions
+                    s++;              // 1 match already done
+                    LUAU_FALLTHROUGH; // go through
+                case '*':             // 0 or more repetitions
+                    s = cmax_expand(ms, cp, s, i);
+                    break;
+                case '-': // 0 or more repetitions (minimum)
+                    s = cmin_expand(ms, cp, s, i);
+                    break;
+                default: // no suffix
+                    s++;
+                    i++;
+                    goto init;
+                }
+            }
+            break;
+        }
+    }
+    ms->matchdepth++;
+    return s;
+}
+
+// }======================================================
+
 static void push_onecapture(MatchState* ms, int i, const char* s, const char* e)
 {
     if (i >= ms->level)
@@ -688,8 +1519,10 @@ static int str_find_aux(lua_State* L, int find)
     else
     {
         MatchState ms;
+        CompiledPattern cp;
         const char* s1 = s + init - 1;
         int anchor = (*p == '^');
+        bool compiled = getpattern(L, 2, p, lp, anchor, &cp);
         if (anchor)
         {
             p++;
@@ -699,8 +1532,10 @@ static int str_find_aux(lua_State* L, int find)
         do
         {
             const char* res;
+            if (compiled && !anchor && (s1 = nextcandidate(&cp, s1, ms.src_end)) == NULL)
+                break;
             reprepstate(&ms);
-            if ((res = match(&ms, s1, p)) != NULL)
+            if ((res = compiled ? cmatch(&ms, &cp, s1, 0) : match(&ms, s1, p)) != NULL)
             {
                 if (find)
                 {
@@ -734,12 +1569,16 @@ static int gmatch_aux(lua_State* L)
     const char* s = lua_tolstring(L, lua_upvalueindex(1), &ls);
     const char* p = lua_tolstring(L, lua_upvalueindex(2), &lp);
     const char* src;
+    CompiledPattern cp;
+    bool compiled = getpattern(L, lua_upvalueindex(2), p, lp, 0, &cp);
     prepstate(&ms, L, s, ls, p, lp);
     for (src = s + (size_t)lua_tointeger(L, lua_upvalueindex(3)); src <= ms.src_end; src++)
     {
         const char* e;
+        if (compiled && (src = nextcandidate(&cp, src, ms.src_end)) == NULL)
+            break;
         reprepstate(&ms);
-        if ((e = match(&ms, src, p)) != NULL)
+        if ((e = compiled ? cmatch(&ms, &cp, src, 0) : match(&ms, src, p)) != NULL)
         {
             int newstart = (int)(e - s);
             if (e == src)
@@ -838,8 +1677,10 @@ static int str_gsub(lua_State* L)
     int anchor = (*p == '^');
     int n = 0;
     MatchState ms;
+    CompiledPattern cp;
     luaL_Strbuf b;
     luaL_argexpected(L, tr == LUA_TNUMBER || tr == LUA_TSTRING || tr == LUA_TFUNCTION || tr == LUA_TTABLE, 3, "string/function/table");
+    bool compiled = getpattern(L, 2, p, lp, anchor, &cp);
     luaL_buffinit(L, &b);
     if (anchor)
     {
@@ -850,8 +1691,20 @@ static int str_gsub(lua_State* L)
     while (n < max_s)
     {
         const char* e;
+        if (compiled && !anchor)
+        {
+            // text where no match can start is copied as is
+            const char* next = nextcandidate(&cp, src, ms.src_end);
+            if (!next)
+                break;
+            if (next != src)
+            {
+                luaL_addlstring(&b, src, next - src);
+                src = next;
+            }
+        }
         reprepstate(&ms);
-        e = match(&ms, src, p);
+        e = compiled ? cmatch(&ms, &cp, src, 0) : match(&ms, src, p);
         if (e)
         {
             n++;
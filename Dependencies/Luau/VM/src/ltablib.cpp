@@ -8,9 +8,13 @@
 #include "ltable.h"
 #include "lstring.h"
 #include "lgc.h"
+#include "lmem.h"
+#include "ldo.h"
 #include "ldebug.h"
 #include "lvm.h"
 
+#include <string.h>
+
 static int foreachi(lua_State* L)
 {
     luaL_checktype(L, 1, LUA_TTABLE);
@@ -243,6 +247,84 @@ static void addfield(lua_State* L, luaL_Strbuf* b, int i, LuaTable* t)
     }
 }
 
+// Joins t[i..last] when all of it is in the array part and holds strings and numbers, as table.concat(parts) usually
+// does: the lengths are summed first, then everything is copied straight into the result string, so there is a single
+// allocation and no buffer growth. Numbers are formatted once to measure them and again to copy them. Returns false
+// without touching the stack when the general loop has to run (which also reports bad values).
+static bool tconcatarray(lua_State* L, LuaTable* t, int i, int last, const char* sep, size_t lsep)
+{
+    LUAU_ASSERT(i <= last);
+    if (i < 1 || last > t->sizearray)
+        return false;
+
+    size_t total = lsep * size_t(unsigned(last - i));
+    for (int k = i; k <= last; k++)
+    {
+        const TValue* v = &t->array[k - 1];
+        if (ttisstring(v))
+        {
+            total += tsvalue(v)->len;
+        }
+        else if (ttisnumber(v))
+        {
+            char s[LUAI_MAXNUM2STR];
+            total += luai_num2str(s, nvalue(v)) - s;
+        }
+        else
+            return false;
+    }
+
+    // short results are interned from a stack buffer; long ones are written into the string object, as luaV_concat
+    // does, and nothing may allocate until it is finished
+    char buffer[LUA_BUFFERSIZE];
+    TString* ts = NULL;
+    char* d = buffer;
+    if (total >= LUA_BUFFERSIZE)
+    {
+        luaC_checkGC(L);
+        ts = luaS_bufstart(L, total);
+        d = ts->data;
+    }
+
+    for (int k = i; k <= last; k++)
+    {
+        const TValue* v = &t->array[k - 1];
+        if (ttisstring(v))
+        {
+            TString* s = tsvalue(v);
+            memcpy(d, getstr(s), s->len);
+            d += s->len;
+        }
+        else
+        {
+            // luai_num2str may write past the end of the number, so it can't format into the result
+            char s[LUAI_MAXNUM2STR];
+            char* e = luai_num2str(s, nvalue(v));
+            memcpy(d, s, e - s);
+            d += e - s;
+        }
+
+        if (k < last && lsep != 0)
+        {
+            memcpy(d, sep, lsep);
+            d += lsep;
+        }
+    }
+
+    if (ts)
+    {
+        LUAU_ASSERT(d == ts->data + total);
+        setsvalue(L, L->top, luaS_buffinish(L, ts));
+        incr_top(L);
+    }
+    else
+    {
+        LUAU_ASSERT(d == buffer + total);
+        lua_pushlstring(L, buffer, total);
+    }
+    return true;
+}
+
 static int tconcat(lua_State* L)
 {
     size_t lsep;
@@ -253,6 +335,9 @@ static int tconcat(lua_State* L)
 
     LuaTable* t = hvalue(L->base);
 
+    if (i <= last && tconcatarray(L, t, i, last, sep, lsep))
+        return 1;
+
     luaL_Strbuf b;
     luaL_buffinit(L, &b);
     for (; i < last; i++)
@@ -472,6 +557,236 @@ static void sort_rec(lua_State* L, LuaTable* t, int l, int u, int limit, SortPre
     }
 }
 
+// Arrays of only numbers or only strings sorted without a predicate are sorted as raw keys: luaV_lessthan orders those
+// without metamethods or errors, so the keys can be copied out, sorted with inline comparisons and written back.
+struct SortNumberLess
+{
+    bool operator()(double l, double r) const
+    {
+        return l < r;
+    }
+};
+
+struct SortStringLess
+{
+    bool operator()(const TString* l, const TString* r) const
+    {
+        return luaV_strcmp(l, r) < 0;
+    }
+};
+
+template<typename T>
+inline void sort_keyswap(T& l, T& r)
+{
+    T temp = l;
+    l = r;
+    r = temp;
+}
+
+template<typename T, typename Less>
+static void sort_keysift(T* a, int root, int count, Less less)
+{
+    for (int child; (child = root * 2 + 1) < count; root = child)
+    {
+        if (child + 1 < count && less(a[child], a[child + 1]))
+            child++;
+        if (!less(a[root], a[child]))
+            break;
+
+        sort_keyswap(a[root], a[child]);
+    }
+}
+
+template<typename T, typename Less>
+static void sort_keyheap(T* a, int count, Less less)
+{
+    for (int i = count / 2 - 1; i >= 0; --i)
+        sort_keysift(a, i, count, less);
+
+    for (int i = count - 1; i > 0; --i)
+    {
+        sort_keyswap(a[0], a[i]);
+        sort_keysift(a, 0, i, less);
+    }
+}
+
+template<typename T, typename Less>
+static void sort_keys(T* a, int l, int u, int limit, Less less)
+{
+    // sort range [l..u] (inclusive) with quick sort down to short ranges, which insertion sort finishes
+    while (u - l >= 16)
+    {
+        // if the limit has been reached, quick sort is going over the permitted nlogn complexity, so we fall back to heap sort
+        if (limit == 0)
+            return sort_keyheap(a + l, u - l + 1, less);
+
+        // order a[l], a[m] and a[u]; a[m] becomes the pivot, and a[l] and a[u] stop the scans below
+        int m = l + ((u - l) >> 1);
+        if (less(a[u], a[l]))
+            sort_keyswap(a[u], a[l]);
+        if (less(a[m], a[l]))
+            sort_keyswap(a[m], a[l]);
+        else if (less(a[u], a[m]))
+            sort_keyswap(a[m], a[u]);
+
+        T p = a[m];
+        int i = l;
+        int j = u;
+        for (;;)
+        { // invariant: a[l..i] <= P <= a[j..u]
+            while (less(a[++i], p))
+            {
+            }
+            while (less(p, a[--j]))
+            {
+            }
+            if (j <= i)
+                break;
+            sort_keyswap(a[i], a[j]);
+        }
+
+        // a[l..i-1] <= P <= a[j+1..u], and a[i] == P when i == j
+        limit = (limit >> 1) + (limit >> 2);
+
+        // sort smaller half recursively; the larger half is sorted in the next loop iteration
+        if (i - l < u - j)
+        {
+            sort_keys(a, l, i - 1, limit, less);
+            l = j + 1;
+        }
+        else
+        {
+            sort_keys(a, j + 1, u, limit, less);
+            u = i - 1;
+        }
+    }
+
+    for (int i = l + 1; i <= u; i++)
+    {
+        T v = a[i];
+        int j = i;
+        for (; j > l && less(v, a[j - 1]); j--)
+            a[j] = a[j - 1];
+        a[j] = v;
+    }
+}
+
+// Doubles as unsigned integers in the same order: negative values have all bits flipped, the rest just the sign bit.
+static uint64_t sort_numberkey(double v)
+{
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return bits ^ (uint64_t(int64_t(bits) >> 63) | (1ull << 63));
+}
+
+static double sort_keynumber(uint64_t key)
+{
+    key ^= ((key >> 63) - 1) | (1ull << 63);
+    double v;
+    memcpy(&v, &key, sizeof(v));
+    return v;
+}
+
+// Long number arrays are sorted by radix a byte at a time, which takes no branches on the data; bytes that are the same
+// in every key (the high exponent bits of numbers of similar magnitude, usually) take no pass at all.
+static const int kSortRadixMin = 256;
+
+static void sort_radix(lua_State* L, TValue* arr, int n)
+{
+    uint64_t* keys = luaM_newarray(L, 2 * size_t(n), uint64_t, 0);
+    uint64_t* src = keys;
+    uint64_t* dst = keys + n;
+
+    unsigned counts[8][256] = {};
+    for (int i = 0; i < n; i++)
+    {
+        uint64_t key = sort_numberkey(nvalue(&arr[i]));
+        src[i] = key;
+        for (int d = 0; d < 8; d++)
+            counts[d][(key >> (d * 8)) & 255]++;
+    }
+
+    for (int d = 0; d < 8; d++)
+    {
+        unsigned* count = counts[d];
+        if (count[(src[0] >> (d * 8)) & 255] == unsigned(n))
+            continue;
+
+        unsigned offset = 0;
+        for (int b = 0; b < 256; b++)
+        {
+            unsigned c = count[b];
+            count[b] = offset;
+            offset += c;
+        }
+
+        for (int i = 0; i < n; i++)
+            dst[count[(src[i] >> (d * 8)) & 255]++] = src[i];
+
+        uint64_t* temp = src;
+        src = dst;
+        dst = temp;
+    }
+
+    for (int i = 0; i < n; i++)
+        setnvalue(&arr[i], sort_keynumber(src[i]));
+    luaM_freearray(L, keys, 2 * size_t(n), uint64_t, 0);
+}
+
+// Sorts t[1..n] as raw keys when they all are numbers (none NaN, which has no order) or all are strings. Returns false
+// without changing anything otherwise, for sort_rec to handle.
+static bool sort_plain(lua_State* L, LuaTable* t, int n)
+{
+    if (n < 2 || n > t->sizearray)
+        return false;
+
+    TValue* arr = t->array;
+    if (ttisnumber(&arr[0]))
+    {
+        for (int i = 0; i < n; i++)
+            if (!ttisnumber(&arr[i]) || nvalue(&arr[i]) != nvalue(&arr[i]))
+                return false;
+
+        if (n >= kSortRadixMin)
+        {
+            sort_radix(L, arr, n);
+            return true;
+        }
+
+        double* keys = luaM_newarray(L, n, double, 0);
+        for (int i = 0; i < n; i++)
+            keys[i] = nvalue(&arr[i]);
+
+        sort_keys(keys, 0, n - 1, n, SortNumberLess());
+
+        for (int i = 0; i < n; i++)
+            setnvalue(&arr[i], keys[i]);
+        luaM_freearray(L, keys, n, double, 0);
+        return true;
+    }
+
+    if (ttisstring(&arr[0]))
+    {
+        for (int i = 0; i < n; i++)
+            if (!ttisstring(&arr[i]))
+                return false;
+
+        TString** keys = luaM_newarray(L, n, TString*, 0);
+        for (int i = 0; i < n; i++)
+            keys[i] = tsvalue(&arr[i]);
+
+        sort_keys(keys, 0, n - 1, n, SortStringLess());
+
+        // no barrier required because the array held all of these strings before the sort
+        for (int i = 0; i < n; i++)
+            setsvalue(L, &arr[i], keys[i]);
+        luaM_freearray(L, keys, n, TString*, 0);
+        return true;
+    }
+
+    return false;
+}
+
 static int tsort(lua_State* L)
 {
     luaL_checktype(L, 1, LUA_TTABLE);
@@ -488,6 +803,9 @@ static int tsort(lua_State* L)
     }
     lua_settop(L, 2); // make sure there are two arguments
 
+    if (pred == luaV_lessthan && sort_plain(L, t, n))
+        return 0;
+
     if (n > 0)
         sort_rec(L, t, 0, n - 1, n, pred);
     return 0;
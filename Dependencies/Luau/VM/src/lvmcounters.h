@@ -0,0 +1,36 @@
+// This file is part of the Luau programming language and is licensed under MIT License; see LICENSE.txt for details
+#pragma once
+
+#include "lbytecode.h"
+
+#include <stdint.h>
+
+// Build with LUAU_VMCOUNTERS=1 to have the interpreter count what it executes. When it is 0 (the default) the
+// counting macros expand to nothing and luau_execute is unchanged.
+#ifndef LUAU_VMCOUNTERS
+#define LUAU_VMCOUNTERS 0
+#endif
+
+struct lua_VmCounters
+{
+    uint64_t ops[LOP__COUNT]; // instructions dispatched, by opcode
+
+    uint64_t fastcallhits;   // FASTCALL* that produced the result
+    uint64_t fastcallmisses; // FASTCALL* that fell back to the CALL
+
+    // table lookups by GETTABLEKS/NAMECALL served from the instruction's slot hint (or, for NAMECALL, the key's main
+    // position) vs ones that needed a full lookup; lookups on non-tables are not counted
+    uint64_t gettablekshits;
+    uint64_t gettableksmisses;
+    uint64_t namecallhits;
+    uint64_t namecallmisses;
+};
+
+#if LUAU_VMCOUNTERS
+// Per OS thread, so states running on different threads never share a counter.
+extern thread_local lua_VmCounters luau_vmcounters;
+
+#define VM_COUNT(field) (luau_vmcounters.field++)
+#else
+#define VM_COUNT(field) ((void)0)
+#endif
@@ -13,6 +13,7 @@
 #include "lbuiltins.h"
 #include "lnumutils.h"
 #include "lbytecode.h"
+#include "lvmcounters.h"
 
 #include <string.h>
 
@@ -119,11 +120,13 @@
  * switch statement to skip a LOP_BREAK instruction.
  */
 #if VM_USE_CGOTO
-#define VM_CASE(op) CASE_##op:
+#define VM_CASE(op) CASE_##op: VM_COUNT(ops[op]);
 #define VM_NEXT() goto*(SingleStep ? &&dispatch : kDispatchTable[LUAU_INSN_OP(*pc)])
 #define VM_CONTINUE(op) goto* kDispatchTable[uint8_t(op)]
 #else
-#define VM_CASE(op) case op:
+#define VM_CASE(op) \
+    case op: \
+        VM_COUNT(ops[op]);
 #define VM_NEXT() goto dispatch
 #define VM_CONTINUE(op) \
     dispatchOp = uint8_t(op); \
@@ -133,6 +136,10 @@
 // Does VM support native execution via ExecutionCallbacks? We mostly assume it does but keep the define to make it easy to quantify the cost.
 #define VM_HAS_NATIVE 1
 
+#if LUAU_VMCOUNTERS
+thread_local lua_VmCounters luau_vmcounters;
+#endif
+
 LUAU_NOINLINE void luau_callhook(lua_State* L, lua_Hook hook, void* userdata)
 {
     ptrdiff_t base = savestack(L, L->base);
@@ -458,11 +465,14 @@ reentry:
                     // fast-path: value is in expected slot
                     if (LUAU_LIKELY(ttisstring(gkey(n)) && tsvalue(gkey(n)) == tsvalue(kv) && !ttisnil(gval(n))))
                     {
+                        VM_COUNT(gettablekshits);
                         setobj2s(L, ra, gval(n));
                         VM_NEXT();
                     }
                     else if (!h->metatable)
                     {
+                        VM_COUNT(gettableksmisses);
+
                         // fast-path: value is not in expected slot, but the table lookup doesn't involve metatable
                         const TValue* res = luaH_getstr(h, tsvalue(kv));
 
@@ -478,6 +488,8 @@ reentry:
                     }
                     else
                     {
+                        VM_COUNT(gettableksmisses);
+
                         // slow-path, may invoke Lua calls via __index metamethod
                         L->cachedslot = slot;
                         VM_PROTECT(luaV_gettable(L, rb, kv, ra));
@@ -814,6 +826,8 @@ reentry:
                     // fast-path: key is in the table in expected slot
                     if (ttisstring(gkey(n)) && tsvalue(gkey(n)) == tsvalue(kv) && !ttisnil(gval(n)))
                     {
+                        VM_COUNT(namecallhits);
+
                         // note: order of copies allows rb to alias ra+1 or ra
                         setobj2s(L, ra + 1, rb);
                         setobj2s(L, ra, gval(n));
@@ -823,12 +837,16 @@ reentry:
                              (mtn = &hvalue(mt)->node[LUAU_INSN_C(insn) & hvalue(mt)->nodemask8]) && ttisstring(gkey(mtn)) &&
                              tsvalue(gkey(mtn)) == tsvalue(kv) && !ttisnil(gval(mtn)))
                     {
+                        VM_COUNT(namecallhits);
+
                         // note: order of copies allows rb to alias ra+1 or ra
                         setobj2s(L, ra + 1, rb);
                         setobj2s(L, ra, gval(mtn));
                     }
                     else
                     {
+                        VM_COUNT(namecallmisses);
+
                         // slow-path: handles full table lookup
                         setobj2s(L, ra + 1, rb);
                         L->cachedslot = LUAU_INSN_C(insn);
@@ -2661,6 +2679,7 @@ reentry:
 
                     if (n >= 0)
                     {
+                        VM_COUNT(fastcallhits);
                         // when nresults != MULTRET, L->top might be pointing to the middle of stack frame if nparams is equal to MULTRET
                         // instead of restoring L->top to L->ci->top if nparams is MULTRET, we do it unconditionally to skip an extra check
                         L->top = (nresults == LUA_MULTRET) ? ra + n : L->ci->top;
@@ -2672,12 +2691,14 @@ reentry:
                     else
                     {
                         // continue execution through the fallback code
+                        VM_COUNT(fastcallmisses);
                         VM_NEXT();
                     }
                 }
                 else
                 {
                     // continue execution through the fallback code
+                    VM_COUNT(fastcallmisses);
                     VM_NEXT();
                 }
             }
@@ -2777,6 +2798,7 @@ reentry:
 
                     if (n >= 0)
                     {
+                        VM_COUNT(fastcallhits);
                         if (nresults == LUA_MULTRET)
                             L->top = ra + n;
 
@@ -2787,12 +2809,14 @@ reentry:
                     else
                     {
                         // continue execution through the fallback code
+                        VM_COUNT(fastcallmisses);
                         VM_NEXT();
                     }
                 }
                 else
                 {
                     // continue execution through the fallback code
+                    VM_COUNT(fastcallmisses);
                     VM_NEXT();
                 }
             }
@@ -2827,6 +2851,7 @@ reentry:
 
                     if (n >= 0)
                     {
+                        VM_COUNT(fastcallhits);
                         if (nresults == LUA_MULTRET)
                             L->top = ra + n;
 
@@ -2837,12 +2862,14 @@ reentry:
                     else
                     {
                         // continue execution through the fallback code
+                        VM_COUNT(fastcallmisses);
                         VM_NEXT();
                     }
                 }
                 else
                 {
                     // continue execution through the fallback code
+                    VM_COUNT(fastcallmisses);
                     VM_NEXT();
                 }
             }
@@ -2877,6 +2904,7 @@ reentry:
 
                     if (n >= 0)
                     {
+                        VM_COUNT(fastcallhits);
                         if (nresults == LUA_MULTRET)
                             L->top = ra + n;
 
@@ -2887,12 +2915,14 @@ reentry:
                     else
                     {
                         // continue execution through the fallback code
+                        VM_COUNT(fastcallmisses);
                         VM_NEXT();
                     }
                 }
                 else
                 {
                     // continue execution through the fallback code
+                    VM_COUNT(fastcallmisses);
                     VM_NEXT();
                 }
             }
@@ -2934,6 +2964,7 @@ reentry:
 
                     if (n >= 0)
                     {
+                        VM_COUNT(fastcallhits);
                         if (nresults == LUA_MULTRET)
                             L->top = ra + n;
 
@@ -2944,12 +2975,14 @@ reentry:
                     else
                     {
                         // continue execution through the fallback code
+                        VM_COUNT(fastcallmisses);
                         VM_NEXT();
                     }
                 }
                 else
                 {
                     // continue execution through the fallback code
+                    VM_COUNT(fastcallmisses);
                     VM_NEXT();
                 }
             }
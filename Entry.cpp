@@ -2,11 +2,17 @@
 #include <string>
 #include <vector>
 
+#include <cerrno>
 #include <cstring>
 #include <cstdio>
 #include <cstdlib>
+#include <fstream>
+
+#include <unistd.h>
 
 #include <Misc/Environment.hpp>
+#include <Misc/Host/WorkerHost.hpp>
+#include <Misc/Host/SourceFile.hpp>
 //#include <Misc/JniBridge.hpp> //I've been trying for a whole week, won't try again in a while. 
 
 #include <Luau/Compiler.h>
@@ -30,142 +36,173 @@
 #include "lua.h"
 
 
-inline char* luau_compileG(const char* source, size_t size, lua_CompileOptions* options, size_t* outsize, std::string* ErrMsg)
-{
-LUAU_ASSERT(outsize);
-
-    Luau::CompileOptions opts;
+static void replaceString(std::string& source, const std::string_view toReplace, const std::string_view replacement) {
+    size_t pos = source.find(toReplace);
 
-    if (options)
-    {
-        static_assert(sizeof(lua_CompileOptions) == sizeof(Luau::CompileOptions), "C and C++ interface must match");
-        memcpy(static_cast<void*>(&opts), options, sizeof(opts));
+    if (pos != std::string::npos) {
+        source.replace(pos, toReplace.length(), replacement);
     }
+}
 
-    std::string result = Luau::compile(std::string(source, size), opts);
-
-    if (result.empty())
-    {
-        if (ErrMsg) {
-            *ErrMsg = "Luau compilation failed: invalid syntax or other compilation error (result was empty).";
-        }
-        *outsize = 0;
-
-        if (ErrMsg) {
-            std::cerr << "DEBUG (luau_compileW): Error: '" << *ErrMsg << "'" << std::endl;
+// --workers N [--init script] [--fork] [scripts...]: runs the scripts (or the paths listed on stdin,
+// one per line) as independent jobs across N worker states and prints the throughput. --fork runs
+// each job in a process forked from one initialized state.
+static int runWorkers(int argc, char** argv) {
+    worker_host::options options;
+    std::vector<std::string> jobs;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            options.workers = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--init") == 0 && i + 1 < argc) {
+            options.init = argv[++i];
+        } else if (std::strcmp(argv[i], "--fork") == 0) {
+            options.fork = true;
         } else {
-            std::cerr << "DEBUG (luau_compileW): Error Message pointer is null." << std::endl;
+            jobs.push_back(argv[i]);
         }
+    }
 
-        return nullptr;
+    if (options.workers == 0) {
+        std::cerr << "--workers needs a positive count." << std::endl;
+        return 1;
     }
 
-    char* copy = static_cast<char*>(malloc(result.size()));
-    if (!copy) {
-        if (ErrMsg) {
-            *ErrMsg = "Memory allocation failed for bytecode.";
+    if (jobs.empty()) {
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            if (!line.empty())
+                jobs.push_back(line);
         }
-        *outsize = 0;
-        return nullptr;
     }
 
-    memcpy(copy, result.data(), result.size());
-    *outsize = result.size();
-    return copy;
-}
+    worker_host::report report = worker_host::run(jobs, options);
 
+    std::printf("%zu jobs on %zu workers in %.3f s (%.1f jobs/s), %zu failed\n", report.jobs, report.workers, report.seconds,
+        report.seconds > 0 ? report.jobs / report.seconds : 0.0, report.failed);
 
-static void replaceString(std::string& source, const std::string_view toReplace, const std::string_view replacement) {
-    size_t pos = source.find(toReplace);
+    return report.failed == 0 ? 0 : 1;
+}
 
-    if (pos != std::string::npos) {
-        source.replace(pos, toReplace.length(), replacement);
+int main(int argc, char** argv) {
+    // SPARK_BYTECODE_CACHE=<dir> keeps compiled chunks on disk between runs.
+    if (const char* cacheDirectory = std::getenv("SPARK_BYTECODE_CACHE")) {
+        bytecode_cache::set_directory(cacheDirectory);
     }
-}
 
-void* luau_alloc(void* ud, void* ptr, size_t osize, size_t nsize) {
-    (void)ud;
-    (void)osize;
+    // SPARK_BYTECODE_CACHE_CAPACITY=<bytes> is the in-memory budget for compiled chunks.
+    if (const char* cacheCapacity = std::getenv("SPARK_BYTECODE_CACHE_CAPACITY")) {
+        char* end = nullptr;
+        unsigned long long bytes = std::strtoull(cacheCapacity, &end, 10);
+        if (end == cacheCapacity || *end != '\0') {
+            std::cerr << "Invalid SPARK_BYTECODE_CACHE_CAPACITY '" << cacheCapacity << "', expected a byte count." << std::endl;
+            return 1;
+        }
+        bytecode_cache::set_capacity(size_t(bytes));
+    }
 
-    if (nsize == 0) {
-        free(ptr);
-        return NULL;
-    } else {
-        return realloc(ptr, nsize);
+    // SPARK_ALLOCATOR=system|slab|arena picks where each state's memory comes from.
+    if (const char* allocator = std::getenv("SPARK_ALLOCATOR")) {
+        host_allocator::kind kind;
+        if (!host_allocator::parse(allocator, kind)) {
+            std::cerr << "Unknown SPARK_ALLOCATOR '" << allocator << "', expected system, slab or arena." << std::endl;
+            return 1;
+        }
+        host_allocator::set_default(kind);
+    }
+
+    // --file <path> runs that script instead of reading one from stdin.
+    const char* sourcePath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--workers") == 0) {
+            return runWorkers(argc, argv);
+        } else if (std::strcmp(argv[i], "--file") == 0 && i + 1 < argc) {
+            sourcePath = argv[++i];
+        }
     }
-}
 
-int main() {
-    lua_State* LS = lua_newstate(luau_alloc, NULL);
+    lua_State* LS = environment::create_state();
 
     if (!LS) {
         std::cerr << "Failed to create Luau state." << std::endl;
         return 1;
     }
+    // SPARK_PROFILE=<path> samples the whole run and writes folded stacks there on exit
+    // (SPARK_PROFILE_HZ sets the rate, 1000 by default).
+    const char* profilePath = std::getenv("SPARK_PROFILE");
+    if (profilePath) {
+        const char* profileHz = std::getenv("SPARK_PROFILE_HZ");
+        sampling_profiler::start(LS, profileHz ? std::clamp(std::atoi(profileHz), 1, 10000) : 1000);
+    }
+
     lua_State* L = lua_newthread(LS); //init script thread. 
     luaL_sandboxthread(L); //forgot what this does, but it sandbox the thread inherited by main state. 
-    luaL_openlibs(LS); //open debug, math, os and etc libs. 
 
-    environment::initialize(LS);// Our Funcs.
-
-    size_t bytecodeSize; //
-    std::string CompileErrorMessage; //Auto Explanatory.
-
-    // here: read input
-    std::string luauCode;
-    std::string line;
-    while (std::getline(std::cin, line)) { // "./Spark.out < InitScript.luau" gets the provided code. 
-        luauCode += line + "\n"; // every line to newline, wow pro. 
+    // "./Spark.out < InitScript.luau" maps the redirected file; a pipe is read in large blocks.
+    source_file source;
+    if (sourcePath ? !source.open(sourcePath) : !source.read(STDIN_FILENO)) {
+        std::cerr << "Failed to read " << (sourcePath ? sourcePath : "std input") << ": " << std::strerror(errno) << std::endl;
+        environment::close_state(LS);
+        return 1;
     }
 
+    std::string_view luauCode = source.view();
+
     if (luauCode.empty()) {
-        std::cerr << "No Luau code provided via std input. Exiting." << std::endl;
-        lua_close(L);
+        std::cerr << "No Luau code provided via " << (sourcePath ? sourcePath : "std input") << ". Exiting." << std::endl;
+        environment::close_state(LS);
         return 1;
     }
 
     std::cout << "\n----COMPILING LUAU CODE FROM STDIN----" << std::endl;
     //std::cerr << "DEBUG: Luau code received (first 10 chars): " << luauCode.substr(0, std::min((size_t)10, luauCode.length())) << (luauCode.length() > 100 ? "..." : "") << std::endl;
 
-    //luau_compileW is from Env. 
-    char* bytecode = luau_compileG(luauCode.c_str(), luauCode.length(), NULL, &bytecodeSize, &CompileErrorMessage);
+    compiler::result compiled = compiler::compile(luauCode);
 
-    if (!bytecode) {
+    if (!compiled) {
         std::cerr << "Luau compilation of InitScript script failed." << std::endl;
-        if (!CompileErrorMessage.empty()) {
-            std::cerr << "Compiler error: " << CompileErrorMessage << std::endl;
-        } else {
-            // This block can be redundant if luau_compileW always set ErrMsg
-            // but it's a really good fallback.
-            if (lua_type(L, -1) == LUA_TSTRING) {
-                std::cerr << "Error from Lua stack (possibly load/pcall): " << lua_tostring(L, -1) << std::endl;
-                lua_pop(L, 1);
-            } else {
-                 std::cerr << "Unknown compilation error for main script (no specific message tho)." << std::endl;
-            }
-        }
-        lua_close(L);
+        std::cerr << "InitScript:" << compiled.error.line << ":" << compiled.error.column << ": " << compiled.error.message << std::endl;
+        environment::close_state(LS);
         return 1;
     }
     std::cout << "\n----Compiled Successfully! ----" << std::endl;
     std::cout << "\n----EXECUTING LUAU CODE----" << std::endl;
-    int loadStatus = luau_load(L, "@InitScript", bytecode, bytecodeSize, 0);
-
-    free(bytecode);
+    lua_setmemcat(L, memory_stats::category(L, "@InitScript"));
+    int loadStatus = luau_load(L, "@InitScript", compiled.bytecode->data(), compiled.bytecode->size(), 0);
 
     if (loadStatus != LUA_OK) {
         std::cerr << "Error loading Luau code: " << lua_tostring(L, -1) << std::endl;
-        lua_close(L);
+        environment::close_state(LS);
         return 1;
     }
 
-    int pcallStatus = lua_pcall(L, 0, LUA_MULTRET, 0); // :(
+    // runs as a task so the script can yield (task.wait) at top level
+    int resumeStatus = lua_resume(L, LS, 0);
 
-    if (pcallStatus != LUA_OK) {
+    if (resumeStatus != LUA_OK && resumeStatus != LUA_YIELD) {
         std::cerr << "Error executing Luau code: " << lua_tostring(L, -1) << std::endl;
     }
 
-    lua_close(L);
+    task_scheduler::run(LS); // until no thread is parked
+
+    misc_library::print_vmstats(std::cerr);
+
+    // SPARK_MEMSTATS=1 reports memory by category and allocating function on exit
+    if (std::getenv("SPARK_MEMSTATS")) {
+        memory_stats::print(LS, std::cerr, 10);
+    }
+
+    if (profilePath) {
+        sampling_profiler::stop(LS);
+
+        std::ofstream profile(profilePath, std::ios::binary);
+        profile << sampling_profiler::dump(LS);
+        if (!profile) {
+            std::cerr << "Failed to write profile to " << profilePath << std::endl;
+        }
+    }
+
+    environment::close_state(LS);
     std::cout << "Luau state closed." << std::endl;
 
     return 0;
@@ -0,0 +1,380 @@
+#include "BytecodeCache.hpp"
+
+#include <Luau/Bytecode.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include <elf.h>
+#include <link.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    constexpr size_t DefaultCapacity = 32 * 1024 * 1024;
+
+    // On-disk entry: header, the source it was compiled from, then the bytecode. Bump the version when
+    // the layout or the key derivation changes so stale files are ignored instead of misread.
+    constexpr char DiskMagic[4] = {'S', 'P', 'B', 'C'};
+    constexpr uint32_t DiskVersion = 3;
+
+    // What produced the bytecode: the format versions the compiler targets, and the binary the compiler
+    // was linked into, since it can change its output without a new format version. Files from any
+    // other compiler are misses.
+    constexpr uint8_t DiskBytecodeVersion = LBC_VERSION_TARGET;
+    constexpr uint8_t DiskTypeVersion = LBC_TYPE_VERSION_TARGET;
+
+    struct DiskHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint8_t bytecodeversion;
+        uint8_t typeversion;
+        uint8_t reserved[6];
+        uint64_t compilerbuild;
+        uint64_t key;
+        uint64_t sourcesize;
+        uint64_t bytecodesize;
+    };
+
+    // The source is kept to confirm a hash match; the hash alone can be made to collide.
+    struct Entry
+    {
+        uint64_t key;
+        std::string source;
+        bytecode_cache::bytecode code;
+    };
+
+    std::mutex s_Mutex;
+    std::list<Entry> s_Entries; // most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> s_Index;
+    std::string s_Directory;
+    bytecode_cache::stats s_Stats = {0, 0, 0, 0, 0, 0, DefaultCapacity};
+
+    // MurmurHash64A, word at a time
+    uint64_t HashBytes(const void* data, size_t size, uint64_t seed)
+    {
+        const uint64_t m = 0xc6a4a7935bd1e995ull;
+        const int r = 47;
+
+        uint64_t h = seed ^ (size * m);
+
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        const unsigned char* end = p + (size & ~size_t(7));
+
+        for (; p != end; p += 8)
+        {
+            uint64_t k;
+            memcpy(&k, p, 8);
+
+            k *= m;
+            k ^= k >> r;
+            k *= m;
+
+            h ^= k;
+            h *= m;
+        }
+
+        uint64_t tail = 0;
+        memcpy(&tail, p, size & 7);
+        if (size & 7)
+        {
+            h ^= tail;
+            h *= m;
+        }
+
+        h ^= h >> r;
+        h *= m;
+        h ^= h >> r;
+        return h;
+    }
+
+    uint64_t HashString(uint64_t h, const char* s)
+    {
+        return s ? HashBytes(s, strlen(s), h) : HashBytes(&h, sizeof(h), 0);
+    }
+
+    uint64_t HashList(uint64_t h, const char* const* list)
+    {
+        if (!list)
+            return HashBytes(&h, sizeof(h), 1);
+
+        for (; *list; list++)
+            h = HashString(h, *list);
+        return h;
+    }
+
+    // Callbacks can't be compared across processes, so their presence keeps an entry out of the cache directory.
+    bool IsPortable(const Luau::CompileOptions& options)
+    {
+        return !options.libraryMemberTypeCb && !options.libraryMemberConstantCb;
+    }
+
+    uint64_t HashKey(std::string_view source, const Luau::CompileOptions& options)
+    {
+        const int levels[] = {options.optimizationLevel, options.debugLevel, options.typeInfoLevel, options.coverageLevel};
+
+        uint64_t h = HashBytes(source.data(), source.size(), 0);
+        h = HashBytes(levels, sizeof(levels), h);
+        h = HashString(h, options.vectorLib);
+        h = HashString(h, options.vectorCtor);
+        h = HashString(h, options.vectorType);
+        h = HashList(h, options.mutableGlobals);
+        h = HashList(h, options.userdataTypes);
+        h = HashList(h, options.librariesWithKnownMembers);
+        h = HashList(h, options.disabledBuiltins);
+
+        if (!IsPortable(options))
+        {
+            const void* callbacks[] = {(const void*)options.libraryMemberTypeCb, (const void*)options.libraryMemberConstantCb};
+            h = HashBytes(callbacks, sizeof(callbacks), h);
+        }
+
+        return h;
+    }
+
+    // The executable's GNU build ID, which the linker derives from everything linked in, so any change
+    // to the compiler changes it. Without one, the executable's own bytes stand in.
+    uint64_t HashBuildId()
+    {
+        uint64_t h = 0;
+        dl_iterate_phdr(
+            [](dl_phdr_info* info, size_t, void* data) {
+                for (int i = 0; i < info->dlpi_phnum; i++)
+                {
+                    const ElfW(Phdr)& phdr = info->dlpi_phdr[i];
+                    if (phdr.p_type != PT_NOTE)
+                        continue;
+
+                    const char* note = reinterpret_cast<const char*>(info->dlpi_addr + phdr.p_vaddr);
+                    const char* end = note + phdr.p_memsz;
+                    while (note + sizeof(ElfW(Nhdr)) <= end)
+                    {
+                        const ElfW(Nhdr)* header = reinterpret_cast<const ElfW(Nhdr)*>(note);
+                        const char* name = note + sizeof(ElfW(Nhdr));
+                        const char* desc = name + ((header->n_namesz + 3) & ~3u);
+                        if (header->n_type == NT_GNU_BUILD_ID && header->n_namesz == 4 && memcmp(name, "GNU", 4) == 0)
+                        {
+                            *static_cast<uint64_t*>(data) = HashBytes(desc, header->n_descsz, 0);
+                            return 1;
+                        }
+                        note = desc + ((header->n_descsz + 3) & ~3u);
+                    }
+                }
+                return 1; // the executable comes first; shared libraries don't identify the compiler
+            },
+            &h);
+
+        if (h != 0)
+            return h;
+
+        std::ifstream self("/proc/self/exe", std::ios::binary);
+        std::string bytes{std::istreambuf_iterator<char>(self), std::istreambuf_iterator<char>()};
+        return HashBytes(bytes.data(), bytes.size(), 0);
+    }
+
+    uint64_t CompilerBuild()
+    {
+        static const uint64_t build = HashBuildId();
+        return build;
+    }
+
+    std::string DiskPath(const std::string& directory, uint64_t key)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.luauc", (unsigned long long)key);
+        return (std::filesystem::path(directory) / name).string();
+    }
+
+    bytecode_cache::bytecode ReadDisk(const std::string& directory, uint64_t key, std::string_view source)
+    {
+        FILE* file = fopen(DiskPath(directory, key).c_str(), "rb");
+        if (!file)
+            return nullptr;
+
+        bytecode_cache::bytecode result;
+
+        DiskHeader header;
+        if (fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, DiskMagic, sizeof(DiskMagic)) == 0 &&
+            header.version == DiskVersion && header.bytecodeversion == DiskBytecodeVersion &&
+            header.typeversion == DiskTypeVersion && header.compilerbuild == CompilerBuild() && header.key == key && header.sourcesize == source.size() && header.bytecodesize != 0)
+        {
+            std::string stored(header.sourcesize, '\0');
+            std::string code(header.bytecodesize, '\0');
+            if (fread(stored.data(), 1, stored.size(), file) == stored.size() && stored == source &&
+                fread(code.data(), 1, code.size(), file) == code.size())
+                result = std::make_shared<const std::string>(std::move(code));
+        }
+
+        fclose(file);
+        return result;
+    }
+
+    // Written under a name unique to this writer and renamed into place, so concurrent readers never see
+    // a partial file, and threads or forked processes writing the same key don't write into each other's.
+    void WriteDisk(const std::string& directory, uint64_t key, std::string_view source, const std::string& code)
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+
+        std::string path = DiskPath(directory, key);
+        std::string temp = path + ".XXXXXX";
+
+        int fd = mkstemp(temp.data());
+        if (fd < 0)
+            return;
+        fchmod(fd, 0644); // mkstemp makes it private to this user
+
+
+        FILE* file = fdopen(fd, "wb");
+        if (!file) {
+            close(fd);
+            std::remove(temp.c_str());
+            return;
+        }
+
+        DiskHeader header = {};
+        memcpy(header.magic, DiskMagic, sizeof(DiskMagic));
+        header.version = DiskVersion;
+        header.bytecodeversion = DiskBytecodeVersion;
+        header.typeversion = DiskTypeVersion;
+        header.compilerbuild = CompilerBuild();
+        header.key = key;
+        header.sourcesize = source.size();
+        header.bytecodesize = code.size();
+
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(source.data(), 1, source.size(), file) == source.size() &&
+                  fwrite(code.data(), 1, code.size(), file) == code.size();
+        ok = fclose(file) == 0 && ok;
+
+        if (!ok || std::rename(temp.c_str(), path.c_str()) != 0)
+            std::remove(temp.c_str());
+    }
+
+    void EvictLocked()
+    {
+        while (s_Stats.bytes > s_Stats.capacity && !s_Entries.empty())
+        {
+            Entry& last = s_Entries.back();
+            s_Stats.bytes -= last.source.size() + last.code->size();
+            s_Index.erase(last.key);
+            s_Entries.pop_back();
+            s_Stats.evictions++;
+        }
+
+        s_Stats.entries = s_Entries.size();
+    }
+
+    void InsertLocked(uint64_t key, std::string_view source, const bytecode_cache::bytecode& code)
+    {
+        if (auto it = s_Index.find(key); it != s_Index.end())
+        {
+            s_Stats.bytes -= it->second->source.size() + it->second->code->size();
+            s_Entries.erase(it->second);
+        }
+
+        s_Entries.push_front(Entry{key, std::string(source), code});
+        s_Index[key] = s_Entries.begin();
+        s_Stats.bytes += source.size() + code->size();
+
+        EvictLocked();
+    }
+}
+
+bytecode_cache::key bytecode_cache::make_key(std::string_view source, const Luau::CompileOptions& options)
+{
+    return key{HashKey(source, options), source, IsPortable(options)};
+}
+
+bytecode_cache::bytecode bytecode_cache::find(const key& key)
+{
+    std::string directory;
+
+    {
+        std::lock_guard lock(s_Mutex);
+
+        if (auto it = s_Index.find(key.hash); it != s_Index.end() && it->second->source == key.source)
+        {
+            s_Entries.splice(s_Entries.begin(), s_Entries, it->second);
+            s_Stats.hits++;
+            return it->second->code;
+        }
+
+        if (key.portable)
+            directory = s_Directory;
+    }
+
+    // disk reads happen outside the lock, another state may be looking up something else
+    bytecode code = directory.empty() ? nullptr : ReadDisk(directory, key.hash, key.source);
+
+    std::lock_guard lock(s_Mutex);
+    if (code)
+    {
+        s_Stats.diskhits++;
+        InsertLocked(key.hash, key.source, code);
+    }
+    else
+    {
+        s_Stats.misses++;
+    }
+
+    return code;
+}
+
+void bytecode_cache::insert(const key& key, const bytecode& code)
+{
+    std::string directory;
+
+    {
+        std::lock_guard lock(s_Mutex);
+        InsertLocked(key.hash, key.source, code);
+
+        if (key.portable)
+            directory = s_Directory;
+    }
+
+    if (!directory.empty())
+        WriteDisk(directory, key.hash, key.source, *code);
+}
+
+void bytecode_cache::set_capacity(size_t bytes)
+{
+    std::lock_guard lock(s_Mutex);
+    s_Stats.capacity = bytes;
+    EvictLocked();
+}
+
+void bytecode_cache::set_directory(std::string directory)
+{
+    std::lock_guard lock(s_Mutex);
+    s_Directory = std::move(directory);
+}
+
+std::string bytecode_cache::get_directory()
+{
+    std::lock_guard lock(s_Mutex);
+    return s_Directory;
+}
+
+void bytecode_cache::clear()
+{
+    std::lock_guard lock(s_Mutex);
+    s_Entries.clear();
+    s_Index.clear();
+    s_Stats.bytes = 0;
+    s_Stats.entries = 0;
+}
+
+bytecode_cache::stats bytecode_cache::get_stats()
+{
+    std::lock_guard lock(s_Mutex);
+    return s_Stats;
+}
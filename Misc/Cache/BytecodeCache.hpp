@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include <Luau/Compiler.h>
+
+// Compiled bytecode keyed by a hash of the source and the compile options. Entries are kept in
+// memory under an LRU byte budget, and optionally mirrored to a directory so a restarted process
+// can skip compilation. Shared by every state in the process; compiler::compile is the usual way in.
+class bytecode_cache
+{
+public:
+	using bytecode = std::shared_ptr<const std::string>;
+
+	struct stats
+	{
+		uint64_t hits = 0;       // served from memory
+		uint64_t diskhits = 0;   // served from the cache directory
+		uint64_t misses = 0;     // compiled
+		uint64_t evictions = 0;  // dropped to stay under capacity
+		size_t entries = 0;
+		size_t bytes = 0;
+		size_t capacity = 0;
+	};
+
+	// Refers to the source it was made from, which must outlive it; a hash match only counts when the
+	// cached entry was compiled from the same source.
+	struct key
+	{
+		uint64_t hash = 0;
+		std::string_view source;
+		bool portable = false; // no callbacks in the options, so the entry may be shared through the cache directory
+	};
+
+	static key make_key(std::string_view source, const Luau::CompileOptions& options);
+
+	// Looks in memory, then in the cache directory. Counts a miss when neither has the entry.
+	static bytecode find(const key& key);
+	// Only successfully compiled bytecode belongs here.
+	static void insert(const key& key, const bytecode& code);
+
+	static void set_capacity(size_t bytes); // counts each entry's source and bytecode
+	static void set_directory(std::string directory); // empty disables the disk cache
+	static std::string get_directory();
+	static void clear();
+	static stats get_stats();
+};
@@ -0,0 +1,103 @@
+#include "Compiler.hpp"
+
+#include <cstring>
+
+#include <Luau/BytecodeBuilder.h>
+#include <Luau/Parser.h>
+
+#include "lobject.h"
+#include "lstate.h"
+#include "../Memory/MemoryStats.hpp"
+
+namespace
+{
+    Luau::CompileOptions ToLuauOptions(const compiler::options& options)
+    {
+        Luau::CompileOptions result;
+        result.optimizationLevel = options.optimization_level;
+        result.debugLevel = options.debug_level;
+        return result;
+    }
+
+    void SetError(compiler::compile_error& error, const Luau::Location& location, std::string message)
+    {
+        error.line = int(location.begin.line) + 1;
+        error.column = int(location.begin.column) + 1;
+        error.message = std::move(message);
+    }
+}
+
+compiler::result compiler::compile(std::string_view source)
+{
+    return compile(source, options());
+}
+
+compiler::result compiler::compile(std::string_view source, const options& options)
+{
+    Luau::CompileOptions luauOptions = ToLuauOptions(options);
+
+    bytecode_cache::key key;
+    if (options.cache)
+    {
+        key = bytecode_cache::make_key(source, luauOptions);
+        if (bytecode_cache::bytecode code = bytecode_cache::find(key))
+            return result{code, compile_error{}};
+    }
+
+    result compiled;
+
+    Luau::Allocator allocator;
+    Luau::AstNameTable names(allocator);
+    Luau::ParseResult parsed = Luau::Parser::parse(source.data(), source.size(), names, allocator);
+
+    if (!parsed.errors.empty())
+    {
+        const Luau::ParseError& first = parsed.errors.front();
+        SetError(compiled.error, first.getLocation(), first.getMessage());
+        return compiled;
+    }
+
+    try
+    {
+        Luau::BytecodeBuilder builder;
+        Luau::compileOrThrow(builder, parsed, names, luauOptions);
+
+        compiled.bytecode = std::make_shared<const std::string>(builder.getBytecode());
+    }
+    catch (Luau::CompileError& e)
+    {
+        SetError(compiled.error, e.getLocation(), e.what());
+        return compiled;
+    }
+
+    if (options.cache)
+        bytecode_cache::insert(key, compiled.bytecode);
+
+    return compiled;
+}
+
+int compiler::load(lua_State* L, const char* chunkname, std::string_view source, int env)
+{
+    return load(L, chunkname, source, env, options());
+}
+
+int compiler::load(lua_State* L, const char* chunkname, std::string_view source, int env, const options& options)
+{
+    result compiled = compile(source, options);
+
+    if (!compiled)
+    {
+        char chunkbuf[LUA_IDSIZE];
+        const char* chunkid = luaO_chunkid(chunkbuf, sizeof(chunkbuf), chunkname, strlen(chunkname));
+        lua_pushfstring(L, "%s:%d: %s", chunkid, compiled.error.line, compiled.error.message.c_str());
+        return LUA_ERRSYNTAX;
+    }
+
+    // the chunk's protos and constants are charged to a category named after it
+    int memcat = L->activememcat;
+    lua_setmemcat(L, memory_stats::category(L, chunkname));
+    int status = luau_load(L, chunkname, compiled.bytecode->data(), compiled.bytecode->size(), env);
+    lua_setmemcat(L, memcat);
+
+    return status;
+}
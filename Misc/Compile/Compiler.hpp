@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+#include "lua.h"
+#include "../Cache/BytecodeCache.hpp"
+
+// The one place source becomes bytecode. Parses straight from the caller's buffer, consults the
+// bytecode cache, and keeps the compiler's own diagnostics instead of flattening them.
+class compiler
+{
+public:
+	struct options
+	{
+		int optimization_level = 1; // see Luau::CompileOptions::optimizationLevel
+		int debug_level = 1;        // see Luau::CompileOptions::debugLevel
+		bool cache = true;
+	};
+
+	struct compile_error
+	{
+		int line = 0;   // 1-based
+		int column = 0; // 1-based
+		std::string message;
+	};
+
+	struct result
+	{
+		bytecode_cache::bytecode bytecode; // null when compilation failed
+		compile_error error;
+
+		explicit operator bool() const { return bytecode != nullptr; }
+	};
+
+	static result compile(std::string_view source);
+	static result compile(std::string_view source, const options& options);
+
+	// Compiles and loads source as a function with the given environment (see luau_load). Returns
+	// LUA_OK with the function pushed, or an error status with the message pushed, formatted the
+	// way luau_load reports it ("chunk:line: message"). What the load allocates goes to the memory
+	// category named after the chunk.
+	static int load(lua_State* L, const char* chunkname, std::string_view source, int env = 0);
+	static int load(lua_State* L, const char* chunkname, std::string_view source, int env, const options& options);
+};
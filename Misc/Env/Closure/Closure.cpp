@@ -1,56 +1,13 @@
 #include "Closure.hpp"
+#include "../../Environment.hpp"
 #include <unordered_map>
+#include <atomic>
 #include <mutex>
 #include <optional>
 #include <vector>
 #include <format>
-#include <regex>
 
 
-inline char* luau_compileH(const char* source, size_t size, lua_CompileOptions* options, size_t* outsize, std::string* ErrMsg)
-{
-LUAU_ASSERT(outsize);
-
-    Luau::CompileOptions opts;
-
-    if (options)
-    {
-        static_assert(sizeof(lua_CompileOptions) == sizeof(Luau::CompileOptions), "C and C++ interface must match");
-        memcpy(static_cast<void*>(&opts), options, sizeof(opts));
-    }
-
-    std::string result = Luau::compile(std::string(source, size), opts);
-
-    if (result.empty())
-    {
-        if (ErrMsg) {
-            *ErrMsg = "Luau compilation failed: invalid syntax or other compilation error (result was empty).";
-        }
-        *outsize = 0;
-
-        if (ErrMsg) {
-            std::cerr << "DEBUG (luau_compileW): Error: '" << *ErrMsg << "'" << std::endl;
-        } else {
-            std::cerr << "DEBUG (luau_compileW): Error Message pointer is null." << std::endl;
-        }
-
-        return nullptr;
-    }
-
-    char* copy = static_cast<char*>(malloc(result.size()));
-    if (!copy) {
-        if (ErrMsg) {
-            *ErrMsg = "Memory allocation failed for bytecode.";
-        }
-        *outsize = 0;
-        return nullptr;
-    }
-
-    memcpy(copy, result.data(), result.size());
-    *outsize = result.size();
-    return copy;
-}
-
 static LuaTable* getcurrenvH(lua_State* L)
 {
     if (L->ci == L->base_ci) // no enclosing function?
@@ -120,19 +77,177 @@ enum class ClosureType : uint32_t
     NewCClosure,
 };
 
-static std::unordered_map<Closure*, Closure*> s_Newcclosures = {};
-static std::unordered_map<Closure*, Closure*> s_HookedFunctions = {};
-static std::unordered_map<Closure*, Closure*> original_functions = {};
-static std::unordered_map<Closure*, lua_CFunction> s_ExecutorClosures = {};
-static std::unordered_set<Closure*> s_ExecutorFunctions = {};
-static std::unordered_map<Closure*, int> s_TrampolineEnvRefs = {};
+// Hook and newcclosure bookkeeping lives in weak-keyed registry tables, one per state. An entry
+// dies with the closure it describes, and what it points to stays alive exactly as long as that closure.
+// The tables are created with mode "ks" so the collector also shrinks them once their keys die.
+enum class SideTable
+{
+    SavedCClosures,   // closure -> closure it dispatches to
+    WrapperStubs,     // closure dispatched by ClosuresHandler -> stub (lightuserdata)
+    OriginalFunctions, // hooked closure -> clone of the original
+    Count
+};
+
+static char s_SideTableKeys[int(SideTable::Count)];
+
+// Tables of the state that last looked one up on this OS thread; they never move and the registry
+// keeps them alive. Per thread so worker states running in parallel don't trade the cache back and forth.
+static thread_local global_State* s_SideTableOwner = nullptr;
+static thread_local LuaTable* s_SideTables[int(SideTable::Count)] = {};
+static thread_local uint32_t s_SideTableGeneration = 0;
+
+// Bumped for every new state, since one can reuse the address of a closed state another thread cached.
+static std::atomic<uint32_t> s_SideTableStates{0};
 
 enum class FunctionKind { NewCClosure, CClosure, LuauClosure };
 
-Closure* FindSavedCClosure(Closure* closure)
+static void CreateSideTables(lua_State* L)
+{
+    for (int i = 0; i < int(SideTable::Count); i++) {
+        lua_pushlightuserdata(L, &s_SideTableKeys[i]);
+        lua_newtable(L);
+
+        lua_newtable(L);
+        lua_pushstring(L, "ks");
+        lua_setfield(L, -2, "__mode");
+        lua_setmetatable(L, -2);
+
+        lua_rawset(L, LUA_REGISTRYINDEX);
+    }
+
+    s_SideTableStates.fetch_add(1, std::memory_order_relaxed);
+}
+
+static LuaTable* GetSideTable(lua_State* L, SideTable table)
+{
+    uint32_t generation = s_SideTableStates.load(std::memory_order_relaxed);
+    if (s_SideTableOwner != L->global || s_SideTableGeneration != generation) {
+        for (int i = 0; i < int(SideTable::Count); i++) {
+            TValue key;
+            setpvalue(&key, &s_SideTableKeys[i], 0);
+            s_SideTables[i] = hvalue(luaH_get(hvalue(registry(L)), &key));
+        }
+        s_SideTableOwner = L->global;
+        s_SideTableGeneration = generation;
+    }
+
+    return s_SideTables[int(table)];
+}
+
+static const TValue* SideTableGet(lua_State* L, SideTable table, Closure* closure)
 {
-    auto it = s_Newcclosures.find(closure);
-    return it != s_Newcclosures.end() ? it->second : nullptr;
+    TValue key;
+    setclvalue(L, &key, closure);
+    return luaH_get(GetSideTable(L, table), &key);
+}
+
+static void SideTableSet(lua_State* L, SideTable table, Closure* closure, const TValue* value)
+{
+    LuaTable* t = GetSideTable(L, table);
+
+    TValue key;
+    setclvalue(L, &key, closure);
+    setobj2t(L, luaH_set(L, t, &key), value);
+    luaC_barriert(L, t, value);
+
+    // hooks allocate several objects per call without passing through the VM, keep the collector paced
+    luaC_checkGC(L);
+}
+
+static Closure* SideTableClosure(lua_State* L, SideTable table, Closure* closure)
+{
+    const TValue* value = SideTableGet(L, table, closure);
+    return ttisfunction(value) ? clvalue(value) : nullptr;
+}
+
+static void SideTableSetClosure(lua_State* L, SideTable table, Closure* closure, Closure* value)
+{
+    TValue v;
+    setclvalue(L, &v, value);
+    SideTableSet(L, table, closure, &v);
+}
+
+static void SideTableErase(lua_State* L, SideTable table, Closure* closure)
+{
+    // cleared in place; going through luaH_set would add a key for a closure that has no entry
+    TValue* value = const_cast<TValue*>(SideTableGet(L, table, closure));
+    if (!ttisnil(value))
+        setnilvalue(value);
+}
+
+// Copies from's entry (if any) over to.
+static void SideTableCopy(lua_State* L, SideTable table, Closure* from, Closure* to)
+{
+    // a copy, since inserting to's key can rehash the table and free the node from's entry lives in
+    TValue value = *SideTableGet(L, table, from);
+    if (!ttisnil(&value))
+        SideTableSet(L, table, to, &value);
+}
+
+static lua_CFunction FindClosureHandler(lua_State* L, Closure* closure)
+{
+    const TValue* value = SideTableGet(L, SideTable::WrapperStubs, closure);
+    return ttislightuserdata(value) ? (lua_CFunction)pvalue(value) : nullptr;
+}
+
+static void SetClosureHandler(lua_State* L, Closure* closure, lua_CFunction stub)
+{
+    TValue v;
+    setpvalue(&v, (void*)stub, 0);
+    SideTableSet(L, SideTable::WrapperStubs, closure, &v);
+}
+
+static int ClosuresHandler(lua_State* L);
+int NewCClosureStub(lua_State* L);
+int NonYieldNewCClosureStub(lua_State* L);
+
+// Wrappers made by newcclosure call the stub directly and keep the wrapped closure in
+// upvalue 1, so dispatch is a plain C call. Closures hooked in place can't grow their
+// upvalue array; those go through ClosuresHandler and the side tables instead.
+static bool IsSlotWrapper(Closure* closure)
+{
+    return closure->isC && closure->nupvalues >= 1 &&
+        (closure->c.f == NewCClosureStub || closure->c.f == NonYieldNewCClosureStub);
+}
+
+Closure* FindSavedCClosure(lua_State* L, Closure* closure)
+{
+    if (IsSlotWrapper(closure))
+        return clvalue(&closure->c.upvals[0]);
+
+    return SideTableClosure(L, SideTable::SavedCClosures, closure);
+}
+
+static lua_CFunction FindWrapperStub(lua_State* L, Closure* closure)
+{
+    if (IsSlotWrapper(closure))
+        return closure->c.f;
+
+    lua_CFunction stub = FindClosureHandler(L, closure);
+    return stub ? stub : NewCClosureStub;
+}
+
+// Call SetWrapperStub before SetSavedCClosure, it decides where the target is stored.
+static void SetWrapperStub(lua_State* L, Closure* closure, lua_CFunction stub)
+{
+    if (IsSlotWrapper(closure)) {
+        closure->c.f = stub;
+        return;
+    }
+
+    closure->c.f = ClosuresHandler;
+    SetClosureHandler(L, closure, stub);
+}
+
+static void SetSavedCClosure(lua_State* L, Closure* closure, Closure* target)
+{
+    if (IsSlotWrapper(closure)) {
+        setclvalue(L, &closure->c.upvals[0], target);
+        luaC_barrier(L, closure, &closure->c.upvals[0]);
+        return;
+    }
+
+    SideTableSetClosure(L, SideTable::SavedCClosures, closure, target);
 }
 
 // Handler functions
@@ -141,48 +256,156 @@ static void handler_run(lua_State* L, void* ud)
     luaD_call(L, (StkId)ud, LUA_MULTRET);
 }
 
-std::string ErrorMessage(const std::string& message) {
-    static const std::regex callstack_regex(
-        R"(.*"\]:(\d)*: )",
-        std::regex_constants::optimize | std::regex_constants::icase);
-    if (std::regex_search(message.begin(), message.end(), callstack_regex)) {
-        const auto fixed = std::regex_replace(message, callstack_regex, "");
-        return fixed;
+// Length of a `"]:<digits>: ` chunkname location starting at s, 0 when there is none.
+static size_t MatchChunkLocation(const char* s, const char* end)
+{
+    if (end - s < 3 || s[0] != '"' || s[1] != ']' || s[2] != ':')
+        return 0;
+
+    const char* p = s + 3;
+    while (p < end && *p >= '0' && *p <= '9')
+        p++;
+
+    if (end - p < 2 || p[0] != ':' || p[1] != ' ')
+        return 0;
+
+    return p + 2 - s;
+}
+
+// Where a line starts once everything up to its last chunkname location is dropped.
+static const char* SkipChunkLocation(const char* line, const char* end)
+{
+    for (const char* p = end; p-- > line;) {
+        if (*p != '"')
+            continue;
+        if (size_t len = MatchChunkLocation(p, end))
+            return p + len;
     }
 
-    return message;
+    return line;
 }
 
-static int ClosuresHandler(lua_State* L)
+// First `<non-colon run>:<digits>:` plus one optional whitespace, the location luaG_runerror prepends.
+static bool FindLocationPrefix(const char* s, const char* end, const char** from, const char** to)
 {
-    auto found = s_ExecutorClosures.find(curr_func(L));
-    if (found != s_ExecutorClosures.end()) {
-        return found->second(L);
+    const char* run = s;
+    for (const char* p = s; p < end; p++) {
+        if (*p != ':')
+            continue;
+
+        if (p > run) {
+            const char* q = p + 1;
+            while (q < end && *q >= '0' && *q <= '9')
+                q++;
+
+            if (q > p + 1 && q < end && *q == ':') {
+                q++;
+                if (q < end && (*q == ' ' || (*q >= '\t' && *q <= '\r')))
+                    q++;
+
+                *from = run;
+                *to = q;
+                return true;
+            }
+        }
+
+        run = p + 1;
     }
-    return 0;
+
+    return false;
 }
 
-int NewCClosureContinuation(lua_State* L, std::int32_t status) {
-    if (status != LUA_OK) {
-        std::size_t error_len;
-        const char* errmsg = luaL_checklstring(L, -1, &error_len);
-        lua_pop(L, 1);
-        std::string error(errmsg);
+static bool HasChunkLocation(const char* s, const char* end)
+{
+    for (const char* p = s; (p = (const char*)memchr(p, '"', end - p)); p++) {
+        if (MatchChunkLocation(p, end))
+            return true;
+    }
 
-        if (error == std::string(("attempt to yield across metamethod/C-call boundary")))
-            return lua_yield(L, LUA_MULTRET);
+    return false;
+}
 
-        std::string fixedError = ErrorMessage(error);
-        const std::regex pattern(R"([^:]+:\d+:\s?)");
+// Pushes the error message with its chunk and line locations stripped, reading straight from the message.
+// Messages without a chunkname location (the common case) don't go through a buffer at all.
+static void PushStrippedError(lua_State* L, const char* msg, size_t len)
+{
+    const char* end = msg + len;
+    const char* from;
+    const char* to;
 
-        std::smatch match;
-        if (std::regex_search(fixedError, match, pattern)) {
-            fixedError.erase(match.position(), match.length());
+    if (!HasChunkLocation(msg, end)) {
+        if (!FindLocationPrefix(msg, end, &from, &to)) {
+            lua_pushlstring(L, msg, len);
+        }
+        else if (from == msg) {
+            lua_pushlstring(L, to, end - to);
         }
+        else {
+            luaL_Strbuf b;
+            luaL_buffinit(L, &b);
+            luaL_addlstring(&b, msg, from - msg);
+            luaL_addlstring(&b, to, end - to);
+            luaL_pushresult(&b);
+        }
+        return;
+    }
 
-        lua_pushlstring(L, fixedError.data(), fixedError.size());
-        lua_error(L);
-        return 0;
+    luaL_Strbuf b;
+    luaL_buffinit(L, &b);
+
+    // '.' in the old pattern stopped at both line terminators, so every line is stripped separately
+    for (const char* line = msg;;) {
+        const char* eol = line;
+        while (eol < end && *eol != '\n' && *eol != '\r')
+            eol++;
+
+        const char* keep = SkipChunkLocation(line, eol);
+        luaL_addlstring(&b, keep, eol - keep);
+
+        if (eol == end)
+            break;
+
+        luaL_addchar(&b, *eol);
+        line = eol + 1;
+    }
+
+    char* data = b.storage ? b.storage->data : b.buffer;
+    if (FindLocationPrefix(data, b.p, &from, &to)) {
+        memmove(data + (from - data), to, b.p - to);
+        b.p -= to - from;
+    }
+
+    luaL_pushresult(&b);
+}
+
+// Rethrows an error caught by the newcclosure stubs, unless it was a yield hitting the C-call boundary.
+// lua_yield raises the pinned LUA_YIELDERRMSG string and strings are interned, so that case is an identity check.
+static int RethrowWrappedError(lua_State* L, int nresults)
+{
+    size_t len;
+    const char* msg = luaL_checklstring(L, -1, &len);
+
+    if (tsvalue(L->top - 1) == luaS_newliteral(L, LUA_YIELDERRMSG)) {
+        lua_pop(L, 1);
+        return lua_yield(L, nresults);
+    }
+
+    PushStrippedError(L, msg, len);
+    lua_error(L);
+    return 0;
+}
+
+static int ClosuresHandler(lua_State* L)
+{
+    if (lua_CFunction handler = FindClosureHandler(L, curr_func(L))) {
+        return handler(L);
+    }
+    return 0;
+}
+
+int NewCClosureContinuation(lua_State* L, std::int32_t status) {
+    if (status != LUA_OK) {
+        return RethrowWrappedError(L, LUA_MULTRET);
     }
 
     return lua_gettop(L);
@@ -196,7 +419,7 @@ int NewCClosureStub(lua_State* L) {
         luaL_error(L, "Invalid closure (NewCClosureStub 1)");
     }
 
-    Closure* originalClosure = FindSavedCClosure(cl);
+    Closure* originalClosure = FindSavedCClosure(L, cl);
     if (!originalClosure) {
         luaL_error(L, "Invalid closure (NewCClosureStub 2)");
     }
@@ -214,25 +437,7 @@ int NewCClosureStub(lua_State* L) {
     L->baseCcalls--;
 
     if (status == LUA_ERRRUN) {
-        size_t error_len;
-        const char* errmsg = luaL_checklstring(L, -1, &error_len);
-        lua_pop(L, 1);
-        std::string error(errmsg);
-
-        if (error == std::string(("attempt to yield across metamethod/C-call boundary")))
-            return lua_yield(L, LUA_MULTRET);
-
-        std::string fixedError = ErrorMessage(error);
-        std::regex pattern(R"([^:]+:\d+:\s?)");
-
-        std::smatch match;
-        if (std::regex_search(fixedError, match, pattern)) {
-            fixedError.erase(match.position(), match.length());
-        }
-
-        lua_pushlstring(L, fixedError.data(), fixedError.size());
-        lua_error(L);
-        return 0;
+        return RethrowWrappedError(L, LUA_MULTRET);
     }
 
     expandstacklimit(L, L->top);
@@ -250,7 +455,7 @@ int NonYieldNewCClosureStub(lua_State* L) {
     if (!cl)
         luaL_error(L, ("Invalid closure (NonYieldNewCClosureStub 1)"));
 
-    const auto originalClosure = FindSavedCClosure(cl);
+    const auto originalClosure = FindSavedCClosure(L, cl);
     if (!originalClosure)
         luaL_error(L, ("Invalid closure (NonYieldNewCClosureStub 2)"));
 
@@ -267,25 +472,7 @@ int NonYieldNewCClosureStub(lua_State* L) {
     L->baseCcalls--;
 
     if (status == LUA_ERRRUN) {
-        std::size_t error_len;
-        const char* errmsg = luaL_checklstring(L, -1, &error_len);
-        lua_pop(L, 1);
-        std::string error(errmsg);
-
-        if (error == std::string(("attempt to yield across metamethod/C-call boundary")))
-            return lua_yield(L, 0);
-
-        std::string fixedError = ErrorMessage(error);
-        std::regex pattern(R"([^:]+:\d+:\s?)");
-
-        std::smatch match;
-        if (std::regex_search(fixedError, match, pattern)) {
-            fixedError.erase(match.position(), match.length());
-        }
-
-        lua_pushlstring(L, fixedError.data(), fixedError.size());
-        lua_error(L);
-        return 0;
+        return RethrowWrappedError(L, 0);
     }
 
     expandstacklimit(L, L->top);
@@ -296,20 +483,24 @@ int NonYieldNewCClosureStub(lua_State* L) {
     return lua_gettop(L);
 }
 
-static ClosureType GetClosureType(Closure* closure)
+static ClosureType GetClosureType(lua_State* L, Closure* closure)
 {
     if (!closure->isC) {
         return ClosureType::LuauClosure;
     }
 
+    if (IsSlotWrapper(closure)) {
+        return ClosureType::NewCClosure;
+    }
+
     // Treat executor-managed cclosures created via either ClosuresHandler or
     // the newer handler() trampoline as non-Roblox closures
     if (closure->c.f != ClosuresHandler) {
         return ClosureType::RobloxClosure;
     }
 
-    if (auto it = s_ExecutorClosures.find(closure); it != s_ExecutorClosures.end()) {
-        if (it->second == NewCClosureStub || it->second == NonYieldNewCClosureStub)
+    if (lua_CFunction handler = FindClosureHandler(L, closure)) {
+        if (handler == NewCClosureStub || handler == NonYieldNewCClosureStub)
             return ClosureType::NewCClosure;
         return ClosureType::ExecutorFunction;
     }
@@ -321,24 +512,17 @@ static ClosureType GetClosureType(Closure* closure)
 static void WrapClosure(lua_State* L, int idx, const char* debugname = nullptr)
 {
     Closure* oldClosure = clvalue(index2addrG(L, idx));
-    if (GetClosureType(oldClosure) == ClosureType::NewCClosure) {
+    if (GetClosureType(L, oldClosure) == ClosureType::NewCClosure) {
         lua_pushvalue(L, idx);
         return;
     }
 
-    lua_ref(L, idx);
-    lua_pushcclosurek(L, ClosuresHandler, debugname, 0, NewCClosureContinuation);
+    // the wrapped closure is upvalue 1 of the wrapper, which also keeps it alive
+    lua_pushvalue(L, idx);
+    lua_pushcclosurek(L, NewCClosureStub, debugname, 1, NewCClosureContinuation);
 
     Closure* newClosure = clvalue(index2addrG(L, -1));
-    s_ExecutorClosures[newClosure] = NewCClosureStub;
-    s_ExecutorFunctions.insert(newClosure);
-
-    newClosure->isC = 1;
     newClosure->env = oldClosure->env;
-
-    lua_ref(L, -1);
-
-    s_Newcclosures[newClosure] = oldClosure;
 }
 
 // Public API functions
@@ -367,19 +551,54 @@ int isexecutorclosure(lua_State* rl) {
         value = closure->l.p->linedefined;
     }
     else {
-        const auto& ClosureList = GetClosureList();
-        value = ClosureList.find(closure) != ClosureList.end();
+        value = luaF_isexecutorclosure(closure);
     }
 
     lua_pushboolean(rl, value);
     return 1;
 }
 
+static int getexecutorclosures(lua_State* L)
+{
+    luaL_trimstack(L, 0);
+
+    // the cursor walks pages in place, so keep the GC from sweeping under it
+    const auto oldGCThreshold = L->global->GCthreshold;
+    L->global->GCthreshold = SIZE_MAX;
+
+    // nothing may allocate during a walk: the first one only counts, then the result table is created
+    // with that many array slots, and the second walk stores into them without growing anything
+    ClosureCursor cursor;
+    luaF_opencursor(L, &cursor);
+
+    int total = 0;
+    while (luaF_nextexecutorclosure(L, &cursor))
+        total++;
+
+    lua_createtable(L, total, 0);
+
+    luaF_opencursor(L, &cursor);
+
+    int count = 0;
+    while (count < total) {
+        Closure* cl = luaF_nextexecutorclosure(L, &cursor);
+        if (!cl)
+            break;
+
+        lua_pushrawclosure(L, cl);
+        lua_rawseti(L, -2, ++count);
+    }
+
+    L->global->GCthreshold = oldGCThreshold;
+
+    return 1;
+}
+
 static int isnewcclosure(lua_State* L)
 {
     if (lua_type(L, 1) != LUA_TFUNCTION) { lua_pushboolean(L, false); return 1; }
     Closure* cl = clvalue(luaA_toobject(L, 1));
-    lua_pushboolean(L, s_Newcclosures.contains(cl));
+    lua_pushboolean(L, cl->isC && FindSavedCClosure(L, cl) != nullptr);
     return 1;
 }
 
@@ -415,11 +634,18 @@ int clonefunction(lua_State* L)
         luaL_error(L, "Invalid closure provided in clonefunction");
     }
 
-    switch (GetClosureType(closure))
+    switch (GetClosureType(L, closure))
     {
     case ClosureType::ExecutorFunction:
         lua_clonecfunction(L, 1);
-        s_ExecutorClosures[clvalue(index2addrG(L, -1))] = s_ExecutorClosures.at(closure);
+        SideTableCopy(L, SideTable::WrapperStubs, closure, clvalue(index2addrG(L, -1)));
+        break;
+    case ClosureType::NewCClosure:
+        lua_clonecfunction(L, 1);
+        if (!IsSlotWrapper(closure)) {
+            SideTableCopy(L, SideTable::WrapperStubs, closure, clvalue(index2addrG(L, -1)));
+            SideTableCopy(L, SideTable::SavedCClosures, closure, clvalue(index2addrG(L, -1)));
+        }
         break;
     case ClosureType::RobloxClosure:
         lua_clonecfunction(L, 1);
@@ -434,19 +660,10 @@ int clonefunction(lua_State* L)
     return 1;
 }
 
-static bool IsWrappedClosure(Closure* cl)
-{
-    return cl->isC && s_Newcclosures.contains(cl);
-}
-
-static Closure* get_backing_lclosure(Closure* nc)
+static Closure* get_backing_lclosure(lua_State* L, Closure* nc)
 {
     if (!nc) return nullptr;
-    // Prefer s_Newcclosures when present
-    auto it = s_Newcclosures.find(nc);
-    if (it != s_Newcclosures.end() && it->second)
-        return it->second;
-    return nullptr;
+    return FindSavedCClosure(L, nc);
 }
 
 int hookfunction(lua_State* L)
@@ -462,39 +679,29 @@ int hookfunction(lua_State* L)
         luaL_error(L, "Invalid closures");
     }
 
-    ClosureType hookWhatType = GetClosureType(hookWhat);
-    ClosureType hookWithType = GetClosureType(hookWith);
+    environment::check_unshared(L, hookWhat, "hookfunction");
 
-    // Save the original function if it hasn't been saved already
-    if (!s_HookedFunctions.contains(hookWhat)) {
+    ClosureType hookWhatType = GetClosureType(L, hookWhat);
+    ClosureType hookWithType = GetClosureType(L, hookWith);
+
+    // Save the original function if it hasn't been saved already, restorefunction reads it back
+    if (!SideTableClosure(L, SideTable::OriginalFunctions, hookWhat)) {
         // Avoid dependency on clonefunction reliability: always duplicate via raw push
         if (lua_iscfunction(L, 1)) lua_clonecfunction(L, 1); else lua_clonefunction(L, 1);
 
         Closure* originalClone = clvalue(index2addrG(L, -1));
-        s_HookedFunctions[hookWhat] = originalClone;
-        original_functions[hookWhat] = originalClone; // Save to original_functions for restore
+        SideTableSetClosure(L, SideTable::OriginalFunctions, hookWhat, originalClone);
         lua_pop(L, 1);
     }
     //INFO("What: {}", (int)hookWhatType);
     //INFO("With: {}", (int)hookWithType);
 
-    if (!s_HookedFunctions.contains(hookWhat)) {
-        // Avoid dependency on clonefunction reliability: always duplicate via raw push
-        if (lua_iscfunction(L, 1)) lua_clonecfunction(L, 1); else lua_clonefunction(L, 1);
-
-        Closure* originalClone = clvalue(index2addrG(L, -1));
-        s_HookedFunctions[hookWhat] = originalClone;
-        lua_pop(L, 1);
-    }
-
     if (hookWhatType == ClosureType::RobloxClosure && hookWithType == ClosureType::RobloxClosure) { // Works
         // debug: C->C hooking
 
         // Clone the "hookWhat" to be returned
         lua_clonecfunction(L, 1);
-        if (auto it = s_Newcclosures.find(hookWhat); it != s_Newcclosures.end()) {
-            s_Newcclosures[clvalue(index2addrG(L, -1))] = it->second;
-        }
+        SideTableCopy(L, SideTable::SavedCClosures, hookWhat, clvalue(index2addrG(L, -1)));
 
         hookWhat->c.f = hookWith->c.f;
         hookWhat->c.cont = hookWith->c.cont;
@@ -510,9 +717,7 @@ int hookfunction(lua_State* L)
             setobj2n(L, &hookWhat->c.upvals[i], &hookWith->c.upvals[i]);
         }
 
-        if (auto it = s_Newcclosures.find(hookWith); it != s_Newcclosures.end()) {
-            s_Newcclosures[hookWhat] = it->second;
-        }
+        SideTableCopy(L, SideTable::SavedCClosures, hookWith, hookWhat);
 
         return 1;
     }
@@ -551,13 +756,11 @@ int hookfunction(lua_State* L)
 
         lua_clonecfunction(L, 1);
 
-        if (auto it = s_ExecutorClosures.find(hookWhat); it != s_ExecutorClosures.end())
-            s_ExecutorClosures[clvalue(index2addrG(L, -1))] = it->second;
+        SideTableCopy(L, SideTable::WrapperStubs, hookWhat, clvalue(index2addrG(L, -1)));
 
-        if (auto itn = s_Newcclosures.find(hookWhat); itn != s_Newcclosures.end())
-            s_Newcclosures[clvalue(index2addrG(L, -1))] = itn->second;
-        if (auto itnw = s_Newcclosures.find(hookWith); itnw != s_Newcclosures.end())
-            s_Newcclosures[hookWhat] = itnw->second;
+        SideTableCopy(L, SideTable::SavedCClosures, hookWhat, clvalue(index2addrG(L, -1)));
+        if (Closure* target = FindSavedCClosure(L, hookWith))
+            SetSavedCClosure(L, hookWhat, target);
 
         hookWhat->stacksize = hookWith->stacksize;
         hookWhat->env = hookWith->env;
@@ -573,12 +776,10 @@ int hookfunction(lua_State* L)
         }
 
         lua_clonecfunction(L, 1);
-        if (auto it = s_ExecutorClosures.find(hookWhat); it != s_ExecutorClosures.end())
-            s_ExecutorClosures[clvalue(index2addrG(L, -1))] = it->second;
+        SideTableCopy(L, SideTable::WrapperStubs, hookWhat, clvalue(index2addrG(L, -1)));
 
         //Handler::SetClosure(hookWhat, Handler::GetClosure(hookWith));
-        if (auto it = s_ExecutorClosures.find(hookWith); it != s_ExecutorClosures.end())
-            s_ExecutorClosures[hookWhat] = it->second;
+        SideTableCopy(L, SideTable::WrapperStubs, hookWith, hookWhat);
         hookWhat->c.cont = (lua_Continuation)hookWith->c.cont;
         hookWhat->env = (LuaTable*)hookWith->env;
 
@@ -604,8 +805,7 @@ int hookfunction(lua_State* L)
 
         lua_clonecfunction(L, 1);
 
-        if (auto it = s_ExecutorClosures.find(hookWhat); it != s_ExecutorClosures.end())
-            s_ExecutorClosures[clvalue(index2addrG(L, -1))] = it->second;
+        SideTableCopy(L, SideTable::WrapperStubs, hookWhat, clvalue(index2addrG(L, -1)));
 
         hookWhat->env = hookWith->env;
         hookWhat->c.f = hookWith->c.f;
@@ -625,10 +825,10 @@ int hookfunction(lua_State* L)
     else if (hookWhatType == ClosureType::ExecutorFunction && hookWithType == ClosureType::LuauClosure) {
         // EX->L hooking: wrap L closure into a handler trampoline (NC behavior)
         lua_clonecfunction(L, 1); // return original C function
-        s_ExecutorClosures[clvalue(index2addrG(L, -1))] = s_ExecutorClosures.at(hookWhat);
+        SideTableCopy(L, SideTable::WrapperStubs, hookWhat, clvalue(index2addrG(L, -1)));
 
-        s_ExecutorClosures[hookWhat] = NonYieldNewCClosureStub;
-        s_Newcclosures[hookWhat] = hookWith;
+        SetWrapperStub(L, hookWhat, NonYieldNewCClosureStub);
+        SetSavedCClosure(L, hookWhat, hookWith);
         return 1;
     }
     else if (hookWhatType == ClosureType::ExecutorFunction && hookWithType == ClosureType::NewCClosure) {
@@ -636,13 +836,10 @@ int hookfunction(lua_State* L)
 
         lua_clonecfunction(L, 1);
         //Handler::SetClosure(clvalue(index2addrG(L, -1)), Handler::GetClosure(hookWhat));
-        if (auto it = s_ExecutorClosures.find(hookWhat); it != s_ExecutorClosures.end())
-            s_ExecutorClosures[clvalue(index2addrG(L, -1))] = it->second;
+        SideTableCopy(L, SideTable::WrapperStubs, hookWhat, clvalue(index2addrG(L, -1)));
 
-        //Handler::SetClosure(hookWhat, NonYieldNewCClosureStub);
-        s_ExecutorClosures[hookWhat] = NonYieldNewCClosureStub;
-        //Handler::Wraps::SetClosure(hookWhat, hookWith);
-        s_Newcclosures[hookWhat] = hookWith;
+        SetWrapperStub(L, hookWhat, NonYieldNewCClosureStub);
+        SetSavedCClosure(L, hookWhat, hookWith);
 
         return 1;
     }
@@ -652,14 +849,11 @@ int hookfunction(lua_State* L)
         // Return original C clone
         lua_clonecfunction(L, 1);
         Closure* ret = clvalue(index2addrG(L, -1));
-        if (auto it = s_ExecutorClosures.find(hookWhat); it != s_ExecutorClosures.end())
-            s_ExecutorClosures[ret] = it->second;
-        if (auto it2 = s_Newcclosures.find(hookWhat); it2 != s_Newcclosures.end())
-            s_Newcclosures[ret] = it2->second;
-
-        // ClosuresHandler/NC stub-based: use NonYield stub with s_Newcclosures lookup
-        s_ExecutorClosures[hookWhat] = NonYieldNewCClosureStub;
-        s_Newcclosures[hookWhat] = hookWith;
+        SideTableCopy(L, SideTable::WrapperStubs, hookWhat, ret);
+        SideTableCopy(L, SideTable::SavedCClosures, hookWhat, ret);
+
+        SetWrapperStub(L, hookWhat, NonYieldNewCClosureStub);
+        SetSavedCClosure(L, hookWhat, hookWith);
         return 1;
     }
     else if (hookWhatType == ClosureType::NewCClosure && hookWithType == ClosureType::RobloxClosure) {
@@ -670,10 +864,8 @@ int hookfunction(lua_State* L)
         }
 
         lua_clonecfunction(L, 1);
-        if (auto it = s_ExecutorClosures.find(hookWhat); it != s_ExecutorClosures.end())
-            s_ExecutorClosures[clvalue(index2addrG(L, -1))] = it->second;
-        if (auto itn = s_Newcclosures.find(hookWhat); itn != s_Newcclosures.end())
-            s_Newcclosures[clvalue(index2addrG(L, -1))] = itn->second;
+        SideTableCopy(L, SideTable::WrapperStubs, hookWhat, clvalue(index2addrG(L, -1)));
+        SideTableCopy(L, SideTable::SavedCClosures, hookWhat, clvalue(index2addrG(L, -1)));
 
         hookWhat->env = hookWith->env;
         hookWhat->c.f = hookWith->c.f;
@@ -700,15 +892,13 @@ int hookfunction(lua_State* L)
 
         lua_clonecfunction(L, 1);
         //Handler::SetClosure(clvalue(index2addrG(L, -1)), Handler::GetClosure(hookWhat));
-        if (auto it = s_ExecutorClosures.find(hookWhat); it != s_ExecutorClosures.end())
-            s_ExecutorClosures[clvalue(index2addrG(L, -1))] = it->second;
-        if (auto itn = s_Newcclosures.find(hookWhat); itn != s_Newcclosures.end())
-            s_Newcclosures[clvalue(index2addrG(L, -1))] = itn->second;
+        SideTableCopy(L, SideTable::WrapperStubs, hookWhat, clvalue(index2addrG(L, -1)));
+        SideTableCopy(L, SideTable::SavedCClosures, hookWhat, clvalue(index2addrG(L, -1)));
 
         //Handler::SetClosure(hookWhat, Handler::GetClosure(hookWith));
-        if (auto it = s_ExecutorClosures.find(hookWith); it != s_ExecutorClosures.end())
-            s_ExecutorClosures[hookWhat] = it->second;
+        SideTableCopy(L, SideTable::WrapperStubs, hookWith, hookWhat);
 
+        hookWhat->c.f = ClosuresHandler;
         hookWhat->env = (LuaTable*)hookWith->env;
         hookWhat->c.cont = hookWith->c.cont;
 
@@ -721,14 +911,12 @@ int hookfunction(lua_State* L)
     else if (hookWhatType == ClosureType::RobloxClosure && hookWithType == ClosureType::LuauClosure) { // Works
         // debug: C->L hooking
 
-        // Build an NC wrapper over hookWith and assign to C function
-        WrapClosure(L, 2);
-        s_Newcclosures[hookWhat] = clvalue(index2addrG(L, -1));
-
         // Clone the "hookWhat" to be returned
         lua_clonecfunction(L, 1);
 
-        hookWhat->c.f = NewCClosureStub;
+        // hookWhat can't hold the dispatch slot, so it dispatches through the side tables
+        SetWrapperStub(L, hookWhat, NewCClosureStub);
+        SetSavedCClosure(L, hookWhat, hookWith);
         hookWhat->c.cont = NewCClosureContinuation;
 
         return 1;
@@ -744,8 +932,7 @@ int hookfunction(lua_State* L)
         lua_clonecfunction(L, 1);
 
         //Handler::SetClosure(hookWhat, Handler::GetClosure(hookWith));
-        if (auto it = s_ExecutorClosures.find(hookWith); it != s_ExecutorClosures.end())
-            s_ExecutorClosures[hookWhat] = it->second;
+        SideTableCopy(L, SideTable::WrapperStubs, hookWith, hookWhat);
 
         hookWhat->c.f = hookWith->c.f;
         hookWhat->c.cont = hookWith->c.cont;
@@ -767,13 +954,9 @@ int hookfunction(lua_State* L)
 
         lua_clonecfunction(L, 1);
 
-        //Handler::SetClosure(hookWhat, Handler::GetClosure(hookWith));
-        if (auto it = s_ExecutorClosures.find(hookWith); it != s_ExecutorClosures.end())
-            s_ExecutorClosures[hookWhat] = it->second;
-        if (auto itn = s_Newcclosures.find(hookWith); itn != s_Newcclosures.end())
-            s_Newcclosures[hookWhat] = itn->second;
+        SetWrapperStub(L, hookWhat, FindWrapperStub(L, hookWith));
+        SetSavedCClosure(L, hookWhat, FindSavedCClosure(L, hookWith));
 
-        hookWhat->c.f = hookWith->c.f;
         hookWhat->c.cont = hookWith->c.cont;
         hookWhat->env = (LuaTable*)hookWith->env;
         hookWhat->stacksize = hookWith->stacksize;
@@ -792,20 +975,7 @@ int hookfunction(lua_State* L)
         lua_setmetatable(L, -2);
         lua_pushrawclosure(L, hookWith);
         lua_setfield(L, -2, "LtoC");
-//real usage
-        //size_t sourceLen;
-        //const char* Source = lua_tolstring(LS, 1, &sourceLen);
-        //const char* ChunkName = luaL_optstring(LS, 2, "@Spark" ); // definitely Roblox2 
-
-        size_t bytecodeSize;
-        std::string compileErrorMessage;
-        //const std::string& bc = luau_compileH(Source, strLen(Source), NULL, &bytecodeSize, &compileErrorMessage);
-    
-//end real usage
-        const char* src = "return LtoC(...)";
-        //const std::string& bc = luau_compileH(src);
-        const std::string& bc = luau_compileH(src, strlen(src), NULL, &bytecodeSize, &compileErrorMessage);
-        if (luau_load(L, "@LtoC", bc.data(), bc.size(), 0) != LUA_OK)
+        if (compiler::load(L, "@LtoC", "return LtoC(...)") != LUA_OK)
         {
             // Clean env
             lua_pop(L, 1);
@@ -829,7 +999,7 @@ int hookfunction(lua_State* L)
     }
     else if (hookWhatType == ClosureType::LuauClosure && hookWithType == ClosureType::NewCClosure) {
         // L->NC hooking: resolve the backing Luau closure for the NC
-        const Closure* backing = get_backing_lclosure(hookWith);
+        const Closure* backing = get_backing_lclosure(L, hookWith);
         if (!backing) { luaL_error(L, "Failed to find closure"); return 0; }
 
         if (hookWhat->nupvalues < backing->nupvalues)
@@ -849,15 +1019,7 @@ int hookfunction(lua_State* L)
         lua_pushrawclosure(L, (Closure*)hookWith);
         lua_setfield(L, -2, "LtoNC");
 
-        size_t bytecodeSize;
-        std::string compileErrorMessage;
-
-        const char* src = "return LtoNC(...)";
-       // const std::string& bc = luau_compileH(src);
-        
-        const std::string& bc = luau_compileH(src, strlen(src), NULL, &bytecodeSize, &compileErrorMessage);
-        
-        if (luau_load(L, "@LtoNC", bc.data(), bc.size(), 0) != LUA_OK)
+        if (compiler::load(L, "@LtoNC", "return LtoNC(...)") != LUA_OK)
         {
             lua_settop(L, 0);
             lua_pushnil(L);
@@ -891,8 +1053,6 @@ int hookfunction(lua_State* L)
 
         lua_pop(L, 1);
 
-        int hookRef = lua_ref(L, 2);
-
         // Prepare a dedicated environment table that delegates to globals and
         // stores the target callable at key "ehook" without using setfenv.
         lua_newtable(L);                 // [ ... env ]
@@ -900,26 +1060,14 @@ int hookfunction(lua_State* L)
         lua_pushvalue(L, LUA_GLOBALSINDEX);
         lua_setfield(L, -2, "__index"); // mt.__index = _G
         lua_setmetatable(L, -2);         // setmetatable(env, mt)
-        lua_getref(L, hookRef);
+        lua_pushvalue(L, 2);
         lua_setfield(L, -2, "ehook"); // env.asshole = hookWith
 
         // Build trampoline that calls env.ehook(...)
+        if (compiler::load(L, "@ehook", "return ehook(...)") != LUA_OK)
         {
-            
-            size_t bytecodeSize;
-            std::string compileErrorMessage;
-            
-            //const std::string& bc = luau_compileH(src, strLen(src), NULL, &bytecodeSize, &compileErrorMessage);
-            
-            const char* src = "return ehook(...)";
-            const std::string& bc = luau_compileH(src, strlen(src), NULL, &bytecodeSize, &compileErrorMessage);
-            
-           // const std::string& bc = luau_compileH(src);
-            if (luau_load(L, "@ehook", bc.data(), bc.size(), 0) != LUA_OK)
-            {
-                lua_pushnil(L);
-                return 0;
-            }
+            lua_pushnil(L);
+            return 0;
         }
 
         // new closure on top, env below; set closure env pointer directly and
@@ -933,23 +1081,14 @@ int hookfunction(lua_State* L)
             newLClosure->env = newEnv;
             luaC_threadbarrier(L);
         }
-        
-        // Anchor the trampoline closure and its environment to prevent GC
-        int trampRef = lua_ref(L, -1);
-        (void)trampRef;
-        // Duplicate env and store a registry ref for it
-        lua_pushvalue(L, -2);
-        int envRef = lua_ref(L, -1);
-        if (newLClosure) s_TrampolineEnvRefs[newLClosure] = envRef;
-        // Clean up stack: remove original env left on stack
-        if (lua_gettop(L) >= 1 && lua_istable(L, -1)) lua_pop(L, 1);
-        lua_ref(L, -1);
 
         lua_clonefunction(L, 1);
-        lua_ref(L, -1);
 
+        // hookWhat now references the trampoline's proto and env, which keeps both alive
         hookWhat->l.p = (Proto*)newLClosure->l.p;
         hookWhat->env = (LuaTable*)newLClosure->env;
+        luaC_objbarrier(L, hookWhat, hookWhat->l.p);
+        luaC_objbarrier(L, hookWhat, hookWhat->env);
 
         for (int i = 0; i < hookWhat->nupvalues; i++) {
             setobj2n(L, &hookWhat->l.uprefs[i], luaO_nilobject);
@@ -988,15 +1127,13 @@ int restorefunction(lua_State* L) {
         return 0;
     }
 
-    auto it = original_functions.find(Function);
-    if (it == original_functions.end()) {
+    Closure* original = SideTableClosure(L, SideTable::OriginalFunctions, Function);
+    if (!original) {
         lua_pushstring(L, "No original function saved for this function");
         lua_error(L);
         return 0;
     }
 
-    Closure* original = it->second;
-
     if (Function->isC) {
         Function->nupvalues = original->nupvalues;
         Function->c.f = original->c.f;
@@ -1015,8 +1152,7 @@ int restorefunction(lua_State* L) {
         Function->l.p = original->l.p;
     }
 
-    s_HookedFunctions.erase(Function);
-    original_functions.erase(it);
+    SideTableErase(L, SideTable::OriginalFunctions, Function);
 
     return 0;
 }
@@ -1046,6 +1182,7 @@ static int hookmetamethod(lua_State* L)
     lua_pushvalue(L, 1);
     if (!lua_getmetatable(L, -1))
         luaL_argerror(L, 1, "object has no metatable");
+    environment::check_unshared(L, -1, "hookmetamethod");
     if (lua_getfield(L, -1, MetatableName) == LUA_TNIL)
     {
         std::string msg = std::format("'{}' is not a valid member of the given object's metatable.", MetatableName);
@@ -1148,6 +1285,8 @@ int closure_library::loadstring(lua_State* L) //if this is commented, it's becau
 */
 void closure_library::initialize(lua_State* L)
 {
+    CreateSideTables(L);
+
     //NewFunction(L, "loadstring", loadstring);
     NewFunction(L, "newcclosure", newcclosure);
     NewFunction(L, "islclosure", islclosure);
@@ -1157,6 +1296,7 @@ void closure_library::initialize(lua_State* L)
     NewFunction(L, "clonefunction", clonefunction);
     NewFunction(L, "isexecutorclosure", isexecutorclosure);
     NewFunction(L, "isourclosure", isexecutorclosure); // alias
+    NewFunction(L, "getexecutorclosures", getexecutorclosures);
     NewFunction(L, "isnewcclosure", isnewcclosure);
     NewFunction(L, "hookfunction", hookfunction);
     NewFunction(L, "replaceclosure", hookfunction); //alias
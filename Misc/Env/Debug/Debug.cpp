@@ -1,7 +1,9 @@
 #include "Debug.hpp"
+#include "../../Environment.hpp"
 
 #include "lmem.h"
 #include <lmem.h>
+#include <unordered_map>
 
 
 static LuaTable* getcurrenvG(lua_State* L)
@@ -63,54 +65,6 @@ LUAU_FORCEINLINE TValue* index2addrW(lua_State* L, int idx)
 
 
 
-inline char* luau_compileF(const char* source, size_t size, lua_CompileOptions* options, size_t* outsize, std::string* ErrMsg)
-{
-LUAU_ASSERT(outsize);
-
-    Luau::CompileOptions opts;
-
-    if (options)
-    {
-        static_assert(sizeof(lua_CompileOptions) == sizeof(Luau::CompileOptions), "C and C++ interface must match");
-        memcpy(static_cast<void*>(&opts), options, sizeof(opts));
-    }
-
-    std::string result = Luau::compile(std::string(source, size), opts);
-
-    if (result.empty())
-    {
-        if (ErrMsg) {
-            *ErrMsg = "Luau compilation failed: invalid syntax or other compilation error (result was empty).";
-        }
-        *outsize = 0;
-
-        if (ErrMsg) {
-            std::cerr << "DEBUG (luau_compileW): Error: '" << *ErrMsg << "'" << std::endl;
-        } else {
-            std::cerr << "DEBUG (luau_compileW): Error Message pointer is null." << std::endl;
-        }
-
-        return nullptr;
-    }
-
-    char* copy = static_cast<char*>(malloc(result.size()));
-    if (!copy) {
-        if (ErrMsg) {
-            *ErrMsg = "Memory allocation failed for bytecode.";
-        }
-        *outsize = 0;
-        return nullptr;
-    }
-
-    memcpy(copy, result.data(), result.size());
-    *outsize = result.size();
-    return copy;
-}
-
-
-
-
-
 struct lua_Page;
 union GCObject;
 
@@ -139,6 +93,218 @@ struct lua_Page
 };
 
 
+namespace
+{
+    // debug.getinfo is called per frame by profilers and loggers, so its result is built without
+    // interning anything in the common case: field names are interned once per state, and the
+    // chunk-derived strings once per source. For Luau functions the result's shape is kept as a
+    // template per source and options; a call clones it and overwrites every field that depends on
+    // the function, so protos sharing a source (and protos reusing a freed one's address) can't see
+    // each other's values.
+    enum InfoString
+    {
+        InfoSource, InfoShortSrc, InfoWhat, InfoLinedefined, InfoCurrentline, InfoNups, InfoIsVararg, InfoNumparams, InfoName, InfoFunc,
+        InfoWhatLua, InfoWhatC, InfoSourceC, InfoShortSrcC,
+        InfoStringCount
+    };
+
+    constexpr const char* kInfoStrings[InfoStringCount] = {
+        "source", "short_src", "what", "linedefined", "currentline", "nups", "is_vararg", "numparams", "name", "func",
+        "Lua", "C", "=[C]", "[C]",
+    };
+
+    // Upvalues of debug.getinfo.
+    enum InfoUpvalue { InfoCacheIndex = 1, InfoStringsIndex, InfoAnchorIndex };
+
+    // Dropped wholesale past this many sources, so a script that keeps loading named chunks can't grow it forever.
+    constexpr size_t kInfoCacheLimit = 4096;
+
+    // Option letters as bits; a mask keys a source's templates. InfoHasName is not an option: a
+    // function with a name gets a template with the field, one without it a template without.
+    enum InfoOption { OptionS = 1, OptionL = 2, OptionU = 4, OptionA = 8, OptionN = 16, OptionF = 32, InfoHasName = 64 };
+
+    struct SourceInfo
+    {
+        TString* source;
+        TString* shortsrc;
+        std::vector<std::pair<int, LuaTable*>> templates; // anchored, never handed out
+    };
+
+    struct InfoCache
+    {
+        TString* strings[InfoStringCount] = {};
+        std::unordered_map<TString*, SourceInfo> sources; // the keys are anchored, so no other string takes their address
+        int anchored = 0;
+    };
+
+    // The strings getinfo reports for functions from this source, computed the first time it is seen.
+    SourceInfo& GetSourceInfo(lua_State* L, InfoCache* cache, TString* source)
+    {
+        auto it = cache->sources.find(source);
+        if (it != cache->sources.end())
+            return it->second;
+
+        if (cache->sources.size() >= kInfoCacheLimit) {
+            cache->sources.clear();
+            cache->anchored = 0;
+            lua_newtable(L);
+            lua_replace(L, lua_upvalueindex(InfoAnchorIndex));
+        }
+
+        char buffer[LUA_IDSIZE];
+        const char* shortsrc = luaO_chunkid(buffer, sizeof(buffer), getstr(source), source->len);
+
+        lua_pushstring(L, shortsrc);
+        TString* shortsrcstring = tsvalue(L->top - 1);
+        lua_rawseti(L, lua_upvalueindex(InfoAnchorIndex), ++cache->anchored);
+
+        luaC_threadbarrier(L);
+        setsvalue(L, L->top, source);
+        incr_top(L);
+        lua_rawseti(L, lua_upvalueindex(InfoAnchorIndex), ++cache->anchored);
+
+        return cache->sources[source] = SourceInfo{source, shortsrcstring, {}};
+    }
+
+    // Bit of an option letter, 0 for an unknown letter.
+    int InfoOptionBit(char option)
+    {
+        switch (option)
+        {
+        case 's': return OptionS;
+        case 'l': return OptionL;
+        case 'u': return OptionU;
+        case 'a': return OptionA;
+        case 'n': return OptionN;
+        case 'f': return OptionF;
+        default: return 0;
+        }
+    }
+
+    // Number of result fields the options in mask add.
+    int InfoFieldCount(int mask)
+    {
+        return (mask & OptionS ? 4 : 0) + (mask & OptionL ? 1 : 0) + (mask & OptionU ? 1 : 0) + (mask & OptionA ? 2 : 0)
+            + (mask & OptionN ? 1 : 0) + (mask & OptionF ? 1 : 0);
+    }
+
+    void SetInfoField(lua_State* L, LuaTable* t, TString* key, const TValue* value)
+    {
+        TValue* slot = luaH_setstr(L, t, key);
+        setobj2t(L, slot, value);
+        luaC_barriert(L, t, value);
+    }
+
+    void SetInfoString(lua_State* L, LuaTable* t, TString* key, TString* value)
+    {
+        TValue v;
+        setsvalue(L, &v, value);
+        SetInfoField(L, t, key, &v);
+    }
+
+    void SetInfoNumber(lua_State* L, LuaTable* t, TString* key, double value)
+    {
+        TValue v;
+        setnvalue(&v, value);
+        SetInfoField(L, t, key, &v);
+    }
+
+    // Sets every field mask asks for on t. info is null for C functions; name may be null.
+    void SetInfoFields(lua_State* L, LuaTable* t, TString** strings, int mask, Closure* f, const SourceInfo* info, int currentline,
+        const TValue* name, const TValue* func)
+    {
+        if (mask & OptionS)
+        {
+            SetInfoString(L, t, strings[InfoSource], info ? info->source : strings[InfoSourceC]);
+            SetInfoString(L, t, strings[InfoShortSrc], info ? info->shortsrc : strings[InfoShortSrcC]);
+            SetInfoString(L, t, strings[InfoWhat], info ? strings[InfoWhatLua] : strings[InfoWhatC]);
+            SetInfoNumber(L, t, strings[InfoLinedefined], info ? f->l.p->linedefined : -1);
+        }
+
+        if (mask & OptionL)
+            SetInfoNumber(L, t, strings[InfoCurrentline], currentline);
+
+        if (mask & OptionU)
+            SetInfoNumber(L, t, strings[InfoNups], f->nupvalues);
+
+        if (mask & OptionA)
+        {
+            SetInfoNumber(L, t, strings[InfoIsVararg], f->isC ? 1 : f->l.p->is_vararg);
+            SetInfoNumber(L, t, strings[InfoNumparams], f->isC ? 0 : f->l.p->numparams);
+        }
+
+        if ((mask & OptionN) && name)
+            SetInfoField(L, t, strings[InfoName], name);
+
+        if (mask & OptionF)
+            SetInfoField(L, t, strings[InfoFunc], func);
+    }
+
+    // The result template for Luau functions from info's source and options, built on first use
+    // from f. Only the source fields are right for every function; the rest have their keys in
+    // place, so that SetProtoFields overwriting them on a clone never inserts one.
+    LuaTable* GetInfoTemplate(lua_State* L, InfoCache* cache, SourceInfo& info, Closure* f, int mask)
+    {
+        int key = mask | (f->l.p->debugname ? InfoHasName : 0);
+        for (auto& [k, t] : info.templates)
+            if (k == key)
+                return t;
+
+        TValue name, placeholder;
+        if (f->l.p->debugname)
+            setsvalue(L, &name, f->l.p->debugname);
+        setbvalue(&placeholder, false);
+
+        lua_createtable(L, 0, InfoFieldCount(mask));
+        LuaTable* t = hvalue(L->top - 1);
+        SetInfoFields(L, t, cache->strings, mask, f, &info, 0, f->l.p->debugname ? &name : nullptr, &placeholder);
+        lua_rawseti(L, lua_upvalueindex(InfoAnchorIndex), ++cache->anchored);
+
+        info.templates.emplace_back(key, t);
+        return t;
+    }
+
+    // Overwrites the fields of a clone of GetInfoTemplate's result that depend on the function.
+    void SetProtoFields(lua_State* L, LuaTable* t, TString** strings, int mask, Closure* f, int currentline, const TValue* func)
+    {
+        Proto* p = f->l.p;
+
+        if (mask & OptionS)
+            SetInfoNumber(L, t, strings[InfoLinedefined], p->linedefined);
+
+        if (mask & OptionL)
+            SetInfoNumber(L, t, strings[InfoCurrentline], currentline);
+
+        if (mask & OptionU)
+            SetInfoNumber(L, t, strings[InfoNups], f->nupvalues);
+
+        if (mask & OptionA)
+        {
+            SetInfoNumber(L, t, strings[InfoIsVararg], p->is_vararg);
+            SetInfoNumber(L, t, strings[InfoNumparams], p->numparams);
+        }
+
+        if ((mask & OptionN) && p->debugname)
+            SetInfoString(L, t, strings[InfoName], p->debugname);
+
+        if (mask & OptionF)
+            SetInfoField(L, t, strings[InfoFunc], func);
+    }
+
+    // Pushes the strings table and the anchor table that follow the cache as getinfo's upvalues.
+    void PushInfoUpvalues(lua_State* L, InfoCache* cache)
+    {
+        lua_newtable(L); // anchor for cached strings; replaced when the cache is dropped
+        lua_createtable(L, InfoStringCount, 0);
+        for (int i = 0; i < InfoStringCount; i++) {
+            lua_pushstring(L, kInfoStrings[i]);
+            cache->strings[i] = tsvalue(L->top - 1);
+            lua_rawseti(L, -2, i + 1);
+        }
+        lua_insert(L, -2);
+    }
+}
+
 namespace Debug {
     Closure* header_get_function(lua_State* L, bool allowCclosure = false, bool popcl = true)
     {
@@ -213,27 +379,15 @@ namespace Debug {
         luaL_checkany(L, 1);
 
         Closure* function = header_get_function(L, true, false);
-        lua_newtable(L);
-
+        array_builder upvalues(L, function->nupvalues);
 
         for (int i = 0; i < function->nupvalues; i++) {
             TValue* upval;
 
-            const char* upvalue_name = aux_upvalue_2(function, i + 1, &upval);
-
-            if (upvalue_name) {
-                if (iscollectable(upval))
-                    luaC_threadbarrier(L);
-
-                lua_rawcheckstack(L, 1);
-
-                L->top->value = upval->value;
-                L->top->tt = upval->tt;
-                L->top++;
-
-                lua_rawseti(L, -2, i + 1);
-            }
-
+            if (aux_upvalue_2(function, i + 1, &upval))
+                upvalues.append(upval);
+            else
+                upvalues.append_nil();
         }
 
         return 1;
@@ -269,6 +423,7 @@ namespace Debug {
     {
         const auto Func = header_get_function(L, false, false);
         const auto idx = lua_tointeger(L, 2);
+        environment::check_unshared(L, Func, "setupvalue");
 
         if (Func->nupvalues <= 0)
         {
@@ -290,22 +445,16 @@ namespace Debug {
         const auto Func = header_get_function(L);
         const auto p = (Proto*)Func->l.p;
 
-        lua_createtable(L, p->sizek, 0);
+        array_builder constants(L, p->sizek);
 
         for (int i = 0; i < p->sizek; i++)
         {
-            TValue k = p->k[i];
+            const TValue* k = &p->k[i];
 
-            if (k.tt == LUA_TNIL || k.tt == LUA_TFUNCTION || k.tt == LUA_TTABLE)
-            {
-                lua_pushnil(L);
-            }
+            if (k->tt == LUA_TNIL || k->tt == LUA_TFUNCTION || k->tt == LUA_TTABLE)
+                constants.append_nil();
             else
-            {
-                luaC_threadbarrier(L)
-                    luaA_pushobject(L, &k);
-            }
-            lua_rawseti(L, -2, i + 1);
+                constants.append(k);
         }
 
         return 1;
@@ -352,6 +501,7 @@ namespace Debug {
         const auto Func = header_get_function(L);
         const auto idx = luaL_checkinteger(L, 2);
         const auto p = (Proto*)Func->l.p;
+        environment::check_unshared(L, Func, "setconstant");
 
         if (p->sizek <= 0)
         {
@@ -386,15 +536,15 @@ namespace Debug {
         bool active = !lua_isnoneornil(L, 2) ? (lua_toboolean(L, 2) != 0) : false;
 
         Proto* p = (Proto*)Func->l.p;
-        lua_createtable(L, p->sizep, 0);
+        array_builder protos(L, p->sizep);
         if (!active)
         {
             // Return non-callable handles for inactive protos (lightuserdata)
             for (int i = 0; i < p->sizep; i++)
             {
-                Proto* proto = p->p[i];
-                lua_pushlightuserdata(L, (void*)proto);
-                lua_rawseti(L, -2, i + 1);
+                TValue handle;
+                setpvalue(&handle, p->p[i], 0);
+                protos.append(&handle);
             }
         }
         else
@@ -402,90 +552,64 @@ namespace Debug {
             // Return active closures for each child proto
             for (int i = 0; i < p->sizep; i++)
             {
-                Proto* proto = p->p[i];
-                Closure* pcl = luaF_newLclosure(L, Func->nupvalues, Func->env, proto);
-                luaC_threadbarrier(L); setclvalue(L, L->top, pcl); L->top++;
-                lua_rawseti(L, -2, i + 1);
+                // stored before the next allocation, so the collector never sees it unreferenced
+                Closure* pcl = luaF_newLclosure(L, Func->nupvalues, Func->env, p->p[i]);
+                protos.append(obj2gco(pcl));
+                luaC_checkGC(L);
             }
         }
         return 1;
     }
 
+    // Body of every cloned proto: returns nothing. Vararg protos keep their PREPVARARGS so the frame is
+    // set up the way the VM expects.
+    constexpr Instruction CloneStubReturn = LOP_RETURN | (0 << 8) | (1 << 16);
+
     Proto* clone_proto(lua_State* L, Proto* proto) /* sUnc is pmo, wants the proto to not be callable */
     {
+        // Nothing here runs the collector, so the unanchored clones can't be swept from under us, and
+        // they stay white until the caller anchors the root, so no barriers are needed either.
         Proto* clone = luaF_newproto(L);
+        const uint8_t memcat = clone->memcat;
 
         clone->sizek = proto->sizek;
-        clone->k = luaM_newarray(L, proto->sizek, TValue, proto->memcat);
+        clone->k = luaM_newarray(L, proto->sizek, TValue, memcat);
         for (int i = 0; i < proto->sizek; ++i)
             setobj2n(L, &clone->k[i], &proto->k[i]);
 
-        clone->lineinfo = clone->lineinfo;
-        clone->locvars = luaM_newarray(L, proto->sizelocvars, LocVar, proto->memcat);
+        // strings are interned and immutable, so the clone just references the same ones
+        clone->sizelocvars = proto->sizelocvars;
+        clone->locvars = luaM_newarray(L, proto->sizelocvars, LocVar, memcat);
         for (int i = 0; i < proto->sizelocvars; ++i)
-        {
-            const auto varname = getstr(proto->locvars[i].varname);
-            const auto varname_size = strlen(varname);
+            clone->locvars[i] = proto->locvars[i];
 
-            clone->locvars[i].varname = luaS_newlstr(L, varname, varname_size);
-            clone->locvars[i].endpc = proto->locvars[i].endpc;
-            clone->locvars[i].reg = proto->locvars[i].reg;
-            clone->locvars[i].startpc = proto->locvars[i].startpc;
-        }
-
-        clone->nups = proto->nups;
         clone->sizeupvalues = proto->sizeupvalues;
-        clone->sizelineinfo = proto->sizelineinfo;
-        clone->linegaplog2 = proto->linegaplog2;
-        clone->sizelocvars = proto->sizelocvars;
-        clone->linedefined = proto->linedefined;
-
-        if (proto->debugname)
-        {
-            const auto debugname = getstr(proto->debugname);
-            const auto debugname_size = strlen(debugname);
-
-            clone->debugname = luaS_newlstr(L, debugname, debugname_size);
-        }
+        clone->upvalues = luaM_newarray(L, proto->sizeupvalues, TString*, memcat);
+        for (int i = 0; i < proto->sizeupvalues; ++i)
+            clone->upvalues[i] = proto->upvalues[i];
 
-        if (proto->source)
-        {
-            const auto source = getstr(proto->source);
-            const auto source_size = strlen(source);
-
-            clone->source = luaS_newlstr(L, source, source_size);
-        }
+        clone->debugname = proto->debugname;
+        clone->source = proto->source;
 
+        clone->nups = proto->nups;
+        clone->linedefined = proto->linedefined;
         clone->numparams = proto->numparams;
         clone->is_vararg = proto->is_vararg;
         clone->maxstacksize = proto->maxstacksize;
         clone->bytecodeid = proto->bytecodeid;
 
-
-        size_t bytecodeSize;
-        std::string CompileErrorMessage;
-
-
-        auto bytecode = luau_compileF("return", strlen("return"), NULL, &bytecodeSize, &CompileErrorMessage);
-        luau_load(L, "@cloneproto", bytecode, bytecodeSize, 0);
-
-        Closure* cl = clvalue(index2addrW(L, -1));
-
-        clone->sizecode = cl->l.p->sizecode;
-        clone->code = luaM_newarray(L, clone->sizecode, Instruction, proto->memcat);
-        for (size_t i = 0; i < cl->l.p->sizecode; i++) {
-            clone->code[i] = cl->l.p->code[i];
-        }
-        lua_pop(L, 1);
+        // no line info: it would describe the original code, not the stub
+        clone->sizecode = proto->is_vararg ? 2 : 1;
+        clone->code = luaM_newarray(L, clone->sizecode, Instruction, memcat);
+        if (proto->is_vararg)
+            clone->code[0] = LOP_PREPVARARGS | (proto->numparams << 8);
+        clone->code[clone->sizecode - 1] = CloneStubReturn;
         clone->codeentry = clone->code;
-        clone->debuginsn = 0;
 
         clone->sizep = proto->sizep;
-        clone->p = luaM_newarray(L, proto->sizep, Proto*, proto->memcat);
+        clone->p = luaM_newarray(L, proto->sizep, Proto*, memcat);
         for (int i = 0; i < proto->sizep; ++i)
-        {
             clone->p[i] = clone_proto(L, proto->p[i]);
-        }
 
         return clone;
     }
@@ -536,25 +660,23 @@ namespace Debug {
 
         if (!active)
         {
+            luaD_checkstack(L, 1);
+
             Proto* cloned_proto = clone_proto(L, wanted_proto);
             Closure* new_closure = luaF_newLclosure(L, closure->nupvalues, L->gt, cloned_proto);
 
-            luaC_checkGC(L);
+            // the cloned protos are reachable only through the closure, so it goes on the stack before a GC step can run
             luaC_threadbarrier(L);
-
-            L->top->value.gc = reinterpret_cast<GCObject*>(new_closure);
-            L->top->tt = LUA_TFUNCTION;
-            luaD_checkstack(L, 1);
+            setclvalue(L, L->top, new_closure);
             L->top++;
+
+            luaC_checkGC(L);
         }
         else
         {
             const global_State* g = L->global;
-            int object_count = 0;
-
-            lua_newtable(L);
+            std::vector<GCObject*> closures;
 
-            lua_gc(L, LUA_GCSTOP, 0);
             for (lua_Page* current_gco_page = g->allgcopages; current_gco_page; )
             {
                 lua_Page* next = current_gco_page->listnext; // block visit might destroy the page
@@ -581,20 +703,13 @@ namespace Debug {
                     if (gc_closure->l.p != wanted_proto)
                         continue;
 
-                    luaC_checkGC(L);
-                    luaC_threadbarrier(L);
-
-                    L->top->value.gc = gc_object;
-                    L->top->tt = gc_object->gch.tt;
-                    luaD_checkstack(L, 1);
-                    L->top++;
-
-                    lua_rawseti(L, -2, ++object_count);
+                    closures.push_back(gc_object);
                 }
 
                 current_gco_page = next;
             }
-            lua_gc(L, LUA_GCRESTART, 0);
+
+            array_builder::push_objects(L, closures);
         }
 
         return 1;
@@ -658,17 +773,11 @@ namespace Debug {
         }
         else
         {
-            int idx = 0;
-            lua_newtable(L);
+            array_builder stack(L, cast_int(ci.top - ci.base));
+            ci = L->ci[-level]; // creating the table can run the collector, which may move the stack
 
             for (auto val = ci.base; val < ci.top; val++)
-            {
-                lua_pushinteger(L, idx++ + 1);
-
-                luaC_threadbarrier(L) luaA_pushobject(L, val);
-
-                lua_settable(L, -3);
-            }
+                stack.append(val);
         }
 
         return 1;
@@ -735,9 +844,11 @@ namespace Debug {
             return 0;
     }
 
+    // debug.getinfo(level or function [, options]): options picks fields as lua_getinfo does
+    // (s = source, short_src, what, linedefined; l = currentline; u = nups; a = is_vararg, numparams;
+    // n = name; f = func), all of them by default.
     int debug_getinfo(lua_State* L)
     {
-
         luaL_checkany(L, 1);
 
         if (!(lua_isfunction(L, 1) || lua_isnumber(L, 1)))
@@ -745,80 +856,69 @@ namespace Debug {
             luaL_argerror(L, 1, "function or number");
         }
 
-        int level;
-        if (lua_isnumber(L, 1))
+        const char* options = luaL_optstring(L, 2, "sluanf");
+        int mask = 0;
+        for (const char* o = options; *o; o++)
+        {
+            int bit = InfoOptionBit(*o);
+            if (bit == 0)
+                luaL_argerror(L, 2, "invalid option");
+            mask |= bit;
+        }
+
+        Closure* f = nullptr;
+        int level = 0;
+        bool active = lua_isnumber(L, 1);
+        if (active)
         {
             level = lua_tointeger(L, 1);
+            if (level < 0 || unsigned(level) >= unsigned(L->ci - L->base_ci))
+                luaL_argerror(L, 1, "invalid level");
+            f = clvalue((L->ci - level)->func);
         }
         else
         {
-            level = -lua_gettop(L);
+            f = clvalue(luaA_toobject(L, 1));
         }
 
-        auto desc = "sluanf";
+        InfoCache* cache = static_cast<InfoCache*>(lua_touserdata(L, lua_upvalueindex(InfoCacheIndex)));
+        TString** strings = cache->strings;
 
-        lua_Debug ar;
-        if (!lua_getinfo(L, level, desc, &ar))
+        // everything that may allocate happens before the table exists
+        int currentline = -1;
+        if (mask & OptionL)
         {
-            luaL_argerror(L, 1, "invalid level");
+            lua_Debug ar;
+            if (active && lua_getinfo(L, level, "l", &ar))
+                currentline = ar.currentline;
+            else if (!active && !f->isC)
+                currentline = f->l.p->linedefined;
         }
 
-        if (!lua_isfunction(L, -1))
-        {
-            luaL_argerror(L, 1, "level does not point to a function.");
-        }
+        TValue func;
+        setclvalue(L, &func, f);
 
-        lua_newtable(L);
+        if (!f->isC)
         {
-            if (std::strchr(desc, 's'))
-            {
-                lua_pushstring(L, ar.source);
-                lua_setfield(L, -2, "source");
-
-                lua_pushstring(L, ar.short_src);
-                lua_setfield(L, -2, "short_src");
-
-                lua_pushstring(L, ar.what);
-                lua_setfield(L, -2, "what");
-
-                lua_pushinteger(L, ar.linedefined);
-                lua_setfield(L, -2, "linedefined");
-            }
-
-            if (std::strchr(desc, 'l'))
-            {
-                lua_pushinteger(L, ar.currentline);
-                lua_setfield(L, -2, "currentline");
-            }
-
-            if (std::strchr(desc, 'u'))
-            {
-                lua_pushinteger(L, ar.nupvals);
-                lua_setfield(L, -2, "nups");
-            }
+            SourceInfo& info = GetSourceInfo(L, cache, f->l.p->source);
+            LuaTable* tmpl = GetInfoTemplate(L, cache, info, f, mask);
 
-            if (std::strchr(desc, 'a'))
-            {
-                lua_pushinteger(L, ar.isvararg);
-                lua_setfield(L, -2, "is_vararg");
+            luaC_checkGC(L);
+            luaC_threadbarrier(L);
+            LuaTable* t = luaH_clone(L, tmpl);
+            sethvalue(L, L->top, t);
+            incr_top(L);
 
-                lua_pushinteger(L, ar.nparams);
-                lua_setfield(L, -2, "numparams");
-            }
+            SetProtoFields(L, t, strings, mask, f, currentline, &func);
+            return 1;
+        }
 
-            if (std::strchr(desc, 'n'))
-            {
-                lua_pushstring(L, ar.name);
-                lua_setfield(L, -2, "name");
-            }
+        const char* cname = f->c.debugname;
+        if ((mask & OptionN) && cname)
+            lua_pushstring(L, cname);
 
-            if (std::strchr(desc, 'f'))
-            {
-                lua_pushvalue(L, -2);
-                lua_remove(L, -3);
-                lua_setfield(L, -2, "func");
-            }
-        }
+        lua_createtable(L, 0, InfoFieldCount(mask));
+        SetInfoFields(L, hvalue(L->top - 1), strings, mask, f, nullptr, currentline, (mask & OptionN) && cname ? L->top - 2 : nullptr, &func);
 
         return 1;
     }
@@ -837,7 +937,9 @@ void debug_library::initialize(lua_State* L)
     NewTableFunction(L, "getproto", Debug::debug_getproto);
     NewTableFunction(L, "getprotos", Debug::debug_getprotos);
     NewTableFunction(L, "getstack", Debug::debug_getstack);
-    NewTableFunction(L, "getinfo", Debug::debug_getinfo);
+    void* cache = lua_newuserdatadtor(L, sizeof(InfoCache), [](void* p) { static_cast<InfoCache*>(p)->~InfoCache(); });
+    PushInfoUpvalues(L, new (cache) InfoCache());
+    NewTableFunction(L, "getinfo", Debug::debug_getinfo, 3);
     NewTableFunction(L, "getupvalue", Debug::debug_getupvalue);
     NewTableFunction(L, "getupvalues", Debug::debug_getupvalues);
     NewTableFunction(L, "getconstant", Debug::debug_getconstant);
@@ -1,4 +1,5 @@
 #include "Metatable.hpp"
+#include "../../Environment.hpp"
 
 namespace Metatable {
     int getrawmetatable(lua_State* L) {
@@ -13,6 +14,7 @@ namespace Metatable {
         luaL_trimstack(L, 2);
         luaL_checkany(L, 1);
         luaL_checktype(L, 2, LUA_TTABLE);
+        environment::check_unshared(L, 1, "setrawmetatable");
         lua_setmetatable(L, 1);
         lua_pushvalue(L, 1);
         return 1;
@@ -22,6 +24,8 @@ namespace Metatable {
         luaL_trimstack(L, 2);
         luaL_checktype(L, 1, LUA_TTABLE);
         luaL_checktype(L, 2, LUA_TBOOLEAN);
+        if (!lua_toboolean(L, 2))
+            environment::check_unshared(L, 1, "setreadonly");
         hvalue(luaA_toobject(L, 1))->readonly = lua_toboolean(L, 2);
         return 0;
     }
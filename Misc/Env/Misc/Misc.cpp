@@ -1,48 +1,9 @@
 #include "Misc.hpp"
 
-inline char* luau_compileY(const char* source, size_t size, lua_CompileOptions* options, size_t* outsize, std::string* ErrMsg)
-{
-LUAU_ASSERT(outsize);
-
-    Luau::CompileOptions opts;
-
-    if (options)
-    {
-        static_assert(sizeof(lua_CompileOptions) == sizeof(Luau::CompileOptions), "C and C++ interface must match");
-        memcpy(static_cast<void*>(&opts), options, sizeof(opts));
-    }
-
-    std::string result = Luau::compile(std::string(source, size), opts);
-
-    if (result.empty())
-    {
-        if (ErrMsg) {
-            *ErrMsg = "Luau compilation failed: invalid syntax or other compilation error (result was empty).";
-        }
-        *outsize = 0;
-
-        if (ErrMsg) {
-            std::cerr << "DEBUG (luau_compileW): Error: '" << *ErrMsg << "'" << std::endl;
-        } else {
-            std::cerr << "DEBUG (luau_compileW): Error Message pointer is null." << std::endl;
-        }
-
-        return nullptr;
-    }
-
-    char* copy = static_cast<char*>(malloc(result.size()));
-    if (!copy) {
-        if (ErrMsg) {
-            *ErrMsg = "Memory allocation failed for bytecode.";
-        }
-        *outsize = 0;
-        return nullptr;
-    }
+#include <fstream>
+#include <iterator>
 
-    memcpy(copy, result.data(), result.size());
-    *outsize = result.size();
-    return copy;
-}
+#include "lvmcounters.h"
 
 int loadstring(lua_State* LS) {//TODO: custom chunk support.
     luaL_checktype(LS, 1, LUA_TSTRING);
@@ -51,23 +12,22 @@ int loadstring(lua_State* LS) {//TODO: custom chunk support.
     const char* Source = lua_tolstring(LS, 1, &sourceLen);
     const char* ChunkName = luaL_optstring(LS, 2, "@Spark" ); // definitely Roblox2 
 
-    size_t bytecodeSize;
-    std::string compileErrorMessage;
-    char* Bytecode = luau_compileY(Source, sourceLen, NULL, &bytecodeSize, &compileErrorMessage);
-
-    if (!Bytecode) {
-        lua_pushnil(LS); // return nil
-        if (!compileErrorMessage.empty()) {
-            lua_pushstring(LS, compileErrorMessage.c_str());
-        } else {
-            lua_pushstring(LS, "Failed to compile Luau code.");
-        }
-        return 2; // (nil, errmsg)
-    }
+    // optional third argument: { optimize = 0..2, debug = 0..2 }
+    compiler::options Options;
+    if (!lua_isnoneornil(LS, 3)) {
+        luaL_checktype(LS, 3, LUA_TTABLE);
+
+        lua_getfield(LS, 3, "optimize");
+        Options.optimization_level = luaL_optinteger(LS, -1, Options.optimization_level);
+        lua_getfield(LS, 3, "debug");
+        Options.debug_level = luaL_optinteger(LS, -1, Options.debug_level);
+        lua_pop(LS, 2);
 
-    int loadStatus = luau_load(LS, ChunkName, Bytecode, bytecodeSize, LUA_GLOBALSINDEX);
+        luaL_argcheck(LS, Options.optimization_level >= 0 && Options.optimization_level <= 2, 3, "optimize must be 0, 1 or 2");
+        luaL_argcheck(LS, Options.debug_level >= 0 && Options.debug_level <= 2, 3, "debug must be 0, 1 or 2");
+    }
 
-    free(Bytecode);
+    int loadStatus = compiler::load(LS, ChunkName, std::string_view(Source, sourceLen), LUA_GLOBALSINDEX, Options);
 
     if (loadStatus != LUA_OK) {
         // err msg should be stack top
@@ -80,7 +40,184 @@ int loadstring(lua_State* LS) {//TODO: custom chunk support.
     return 1;
 }
 
+// The cache is shared by every state in the process and its directory is trusted to hold bytecode, so
+// scripts can only look at it; where it lives and how big it is are set by the host at startup.
+int bytecodecache_getstats(lua_State* L) {
+    bytecode_cache::stats stats = bytecode_cache::get_stats();
+
+    lua_createtable(L, 0, 7);
+    lua_pushnumber(L, double(stats.hits));
+    lua_setfield(L, -2, "hits");
+    lua_pushnumber(L, double(stats.diskhits));
+    lua_setfield(L, -2, "diskhits");
+    lua_pushnumber(L, double(stats.misses));
+    lua_setfield(L, -2, "misses");
+    lua_pushnumber(L, double(stats.evictions));
+    lua_setfield(L, -2, "evictions");
+    lua_pushnumber(L, double(stats.entries));
+    lua_setfield(L, -2, "entries");
+    lua_pushnumber(L, double(stats.bytes));
+    lua_setfield(L, -2, "bytes");
+    lua_pushnumber(L, double(stats.capacity));
+    lua_setfield(L, -2, "capacity");
+    return 1;
+}
+
+int bytecodecache_getdirectory(lua_State* L) {
+    std::string directory = bytecode_cache::get_directory();
+    if (directory.empty())
+        lua_pushnil(L);
+    else
+        lua_pushlstring(L, directory.data(), directory.size());
+    return 1;
+}
+
+#if LUAU_VMCOUNTERS
+// Indexed by LuauOpcode.
+static constexpr const char* kOpcodeNames[LOP__COUNT] = {
+    "NOP", "BREAK", "LOADNIL", "LOADB", "LOADN", "LOADK", "MOVE", "GETGLOBAL", "SETGLOBAL", "GETUPVAL", "SETUPVAL",
+    "CLOSEUPVALS", "GETIMPORT", "GETTABLE", "SETTABLE", "GETTABLEKS", "SETTABLEKS", "GETTABLEN", "SETTABLEN",
+    "NEWCLOSURE", "NAMECALL", "CALL", "RETURN", "JUMP", "JUMPBACK", "JUMPIF", "JUMPIFNOT", "JUMPIFEQ", "JUMPIFLE",
+    "JUMPIFLT", "JUMPIFNOTEQ", "JUMPIFNOTLE", "JUMPIFNOTLT", "ADD", "SUB", "MUL", "DIV", "MOD", "POW", "ADDK",
+    "SUBK", "MULK", "DIVK", "MODK", "POWK", "AND", "OR", "ANDK", "ORK", "CONCAT", "NOT", "MINUS", "LENGTH",
+    "NEWTABLE", "DUPTABLE", "SETLIST", "FORNPREP", "FORNLOOP", "FORGLOOP", "FORGPREP_INEXT", "FASTCALL3",
+    "FORGPREP_NEXT", "NATIVECALL", "GETVARARGS", "DUPCLOSURE", "PREPVARARGS", "LOADKX", "JUMPX", "FASTCALL",
+    "COVERAGE", "CAPTURE", "SUBRK", "DIVRK", "FASTCALL1", "FASTCALL2", "FASTCALL2K", "FORGPREP", "JUMPXEQKNIL",
+    "JUMPXEQKB", "JUMPXEQKN", "JUMPXEQKS", "IDIV", "IDIVK"
+};
+
+static void pushhitrate(lua_State* L, const char* name, uint64_t hits, uint64_t misses) {
+    lua_createtable(L, 0, 2);
+    lua_pushnumber(L, double(hits));
+    lua_setfield(L, -2, "hits");
+    lua_pushnumber(L, double(misses));
+    lua_setfield(L, -2, "misses");
+    lua_setfield(L, -2, name);
+}
+#endif
+
+// vmstats([reset]): what the interpreter executed on this OS thread, or nil in builds without LUAU_VMCOUNTERS.
+int vmstats(lua_State* L) {
+#if LUAU_VMCOUNTERS
+    lua_VmCounters counters = luau_vmcounters;
+    if (lua_toboolean(L, 1))
+        luau_vmcounters = lua_VmCounters{};
+
+    lua_createtable(L, 0, 4);
+
+    lua_newtable(L);
+    for (int op = 0; op < LOP__COUNT; op++) {
+        if (counters.ops[op] == 0)
+            continue;
+        lua_pushnumber(L, double(counters.ops[op]));
+        lua_setfield(L, -2, kOpcodeNames[op]);
+    }
+    lua_setfield(L, -2, "ops");
+
+    pushhitrate(L, "fastcall", counters.fastcallhits, counters.fastcallmisses);
+    pushhitrate(L, "gettableks", counters.gettablekshits, counters.gettableksmisses);
+    pushhitrate(L, "namecall", counters.namecallhits, counters.namecallmisses);
+#else
+    lua_pushnil(L);
+#endif
+    return 1;
+}
+
+void misc_library::print_vmstats(std::ostream& out) {
+#if LUAU_VMCOUNTERS
+    const lua_VmCounters& counters = luau_vmcounters;
+
+    uint64_t total = 0;
+    std::vector<int> ops;
+    for (int op = 0; op < LOP__COUNT; op++) {
+        total += counters.ops[op];
+        if (counters.ops[op] != 0)
+            ops.push_back(op);
+    }
+    std::sort(ops.begin(), ops.end(), [&](int a, int b) { return counters.ops[a] > counters.ops[b]; });
+
+    auto percent = [](uint64_t part, uint64_t whole) { return whole ? 100.0 * double(part) / double(whole) : 0.0; };
+
+    char line[128];
+    out << "----VM COUNTERS----" << std::endl;
+    for (int op : ops) {
+        std::snprintf(line, sizeof(line), "%-14s %14llu %6.2f%%", kOpcodeNames[op], (unsigned long long)counters.ops[op], percent(counters.ops[op], total));
+        out << line << std::endl;
+    }
+
+    auto hitrate = [&](const char* name, uint64_t hits, uint64_t misses) {
+        std::snprintf(line, sizeof(line), "%-14s %14llu hits %14llu misses %6.2f%% hit", name, (unsigned long long)hits, (unsigned long long)misses,
+            percent(hits, hits + misses));
+        out << line << std::endl;
+    };
+    hitrate("fastcall", counters.fastcallhits, counters.fastcallmisses);
+    hitrate("gettableks", counters.gettablekshits, counters.gettableksmisses);
+    hitrate("namecall", counters.namecallhits, counters.namecallmisses);
+#else
+    (void)out;
+#endif
+}
+
+// memstats([sites]): live bytes, allocation counts and sizes by memory category, a size histogram,
+// and the `sites` (default 10) Luau functions that allocated the most bytes.
+int memstats(lua_State* L) {
+    int sites = luaL_optinteger(L, 1, 10);
+    luaL_argcheck(L, sites >= 0, 1, "site count must be non-negative");
+
+    memory_stats::push(L, sites);
+    return 1;
+}
+
+// Scripts only see files under ./workspace, the usual executor sandbox.
+bool workspacepath(std::string_view path) {
+    if (path.empty() || path.front() == '/' || path.front() == '\\')
+        return false;
+
+    size_t start = 0;
+    while (start <= path.size()) {
+        size_t end = path.find_first_of("/\\", start);
+        if (end == std::string_view::npos)
+            end = path.size();
+        if (path.substr(start, end - start) == "..")
+            return false;
+        start = end + 1;
+    }
+
+    return path.find('\0') == std::string_view::npos;
+}
+
+int readfile(lua_State* L) {
+    size_t pathLen;
+    const char* path = luaL_checklstring(L, 1, &pathLen);
+    luaL_argcheck(L, workspacepath(std::string_view(path, pathLen)), 1, "path must stay inside the workspace");
+
+    // the read runs on a worker, so it gets its own copy of the path
+    return yielder::yield_execution(L, [path = "workspace/" + std::string(path, pathLen)]() -> yielder::yield_return {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            throw std::runtime_error("readfile: cannot open " + path);
+
+        auto contents = std::make_shared<std::string>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        if (file.bad())
+            throw std::runtime_error("readfile: cannot read " + path);
+
+        return [contents](lua_State* L) {
+            lua_pushlstring(L, contents->data(), contents->size());
+            return 1;
+        };
+    });
+}
+
 void misc_library::initialize(lua_State* L)
 {
     NewFunction(L, "loadstring", loadstring);
+    NewFunction(L, "readfile", readfile);
+    NewFunction(L, "vmstats", vmstats);
+    NewFunction(L, "memstats", memstats);
+
+    lua_newtable(L);
+    NewTableFunction(L, "getstats", bytecodecache_getstats);
+    NewTableFunction(L, "getdirectory", bytecodecache_getdirectory);
+    lua_setreadonly(L, -1, true);
+    lua_setglobal(L, "bytecodecache");
 }
\ No newline at end of file
@@ -6,4 +6,7 @@ class misc_library
 public:
 	//static int loadstring(lua_State* L);
 	static void initialize(lua_State* L);
+
+	// Opcode counts and inline-cache hit rates of the calling OS thread; prints nothing unless built with LUAU_VMCOUNTERS.
+	static void print_vmstats(std::ostream& out);
 };
\ No newline at end of file
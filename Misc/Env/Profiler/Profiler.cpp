@@ -0,0 +1,335 @@
+#include "Profiler.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Innermost frames kept per sample; deeper stacks lose their outermost frames.
+    constexpr uint32_t kMaxDepth = 64;
+    constexpr size_t kRingSize = 1024; // power of two; drained every tick, so it only fills if the timer stalls
+
+    constexpr uint32_t kGCFrame = 0;
+
+    struct Sample
+    {
+        uint32_t depth;
+        uint32_t frames[kMaxDepth]; // leaf first
+    };
+
+    // One producer, the interrupt callback on the VM thread, and one consumer, whoever holds
+    // Profiler::mutex. Samples are plain frame ids, so the consumer never touches Luau objects.
+    struct SampleRing
+    {
+        std::array<Sample, kRingSize> slots;
+        std::atomic<size_t> head{0}; // next slot to write
+        std::atomic<size_t> tail{0}; // next slot to read
+
+        Sample* reserve()
+        {
+            size_t h = head.load(std::memory_order_relaxed);
+            if (h - tail.load(std::memory_order_acquire) == kRingSize)
+                return nullptr;
+            return &slots[h & (kRingSize - 1)];
+        }
+
+        void commit() { head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+        const Sample* peek()
+        {
+            size_t t = tail.load(std::memory_order_relaxed);
+            if (t == head.load(std::memory_order_acquire))
+                return nullptr;
+            return &slots[t & (kRingSize - 1)];
+        }
+
+        void pop() { tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+    };
+
+    // What a frame id stands for. A proto freed and reallocated at the same address only reuses
+    // the id if it would get the same name anyway.
+    struct Frame
+    {
+        TString* source = nullptr;
+        TString* debugname = nullptr;
+        int linedefined = 0;
+        const char* cname = nullptr;
+    };
+
+    struct Profiler
+    {
+        std::unique_ptr<SampleRing> ring = std::make_unique<SampleRing>();
+        global_State* global = nullptr;
+        std::atomic<uint64_t> dropped{0};
+
+        // VM thread only
+        std::unordered_map<const void*, uint32_t> ids; // Proto* or lua_CFunction
+        std::vector<Frame> frames{Frame{}};
+        std::vector<std::string> names{"(gc)"};
+
+        std::mutex mutex; // consumer side of the ring, counts, stopping
+        std::condition_variable wake;
+        std::map<std::vector<uint32_t>, uint64_t> counts; // root first
+        bool stopping = false;
+
+        std::thread timer;
+
+        ~Profiler();
+    };
+
+    char s_ProfilerKey;
+
+    Profiler* GetProfiler(lua_State* L)
+    {
+        lua_pushlightuserdata(L, &s_ProfilerKey);
+        lua_rawget(L, LUA_REGISTRYINDEX);
+        Profiler* profiler = static_cast<Profiler*>(lua_touserdata(L, -1));
+        lua_pop(L, 1);
+
+        LUAU_ASSERT(profiler);
+        return profiler;
+    }
+
+    std::string FrameName(Closure* cl)
+    {
+        if (cl->isC)
+            return std::string(cl->c.debugname ? cl->c.debugname : "?") + " [C]";
+
+        Proto* p = cl->l.p;
+        char buffer[LUA_IDSIZE];
+        const char* chunk = luaO_chunkid(buffer, sizeof(buffer), getstr(p->source), p->source->len);
+
+        std::string name = std::string(p->debugname ? getstr(p->debugname) : "anonymous") + " " + chunk + ":" + std::to_string(p->linedefined);
+
+        // ';' separates frames in the folded format
+        std::replace(name.begin(), name.end(), ';', ':');
+        return name;
+    }
+
+    uint32_t FrameId(Profiler* p, Closure* cl)
+    {
+        Frame frame;
+        const void* key;
+        if (cl->isC)
+        {
+            key = reinterpret_cast<const void*>(cl->c.f);
+            frame.cname = cl->c.debugname;
+        }
+        else
+        {
+            key = cl->l.p;
+            frame.source = cl->l.p->source;
+            frame.debugname = cl->l.p->debugname;
+            frame.linedefined = cl->l.p->linedefined;
+        }
+
+        auto [it, inserted] = p->ids.try_emplace(key, 0);
+        if (!inserted)
+        {
+            const Frame& known = p->frames[it->second];
+            if (known.source == frame.source && known.debugname == frame.debugname && known.linedefined == frame.linedefined &&
+                known.cname == frame.cname)
+                return it->second;
+        }
+
+        it->second = uint32_t(p->frames.size());
+        p->frames.push_back(frame);
+        p->names.push_back(FrameName(cl));
+        return it->second;
+    }
+
+    // Armed by the timer thread for one sample. Also called from GC steps (gc >= 0), which are
+    // charged to a "(gc)" leaf under the stack that triggered them. Must not allocate Luau objects.
+    void OnInterrupt(lua_State* L, int gc)
+    {
+        global_State* g = L->global;
+        Profiler* p = static_cast<Profiler*>(g->cb.userdata);
+        g->cb.interrupt = nullptr;
+
+        Sample* sample = p->ring->reserve();
+        if (!sample)
+        {
+            p->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        uint32_t depth = 0;
+        if (gc >= 0)
+            sample->frames[depth++] = kGCFrame;
+
+        for (CallInfo* ci = L->ci; ci > L->base_ci && depth < kMaxDepth; ci--)
+        {
+            if (ttisfunction(ci->func))
+                sample->frames[depth++] = FrameId(p, clvalue(ci->func));
+        }
+
+        if (depth == 0)
+            return;
+
+        sample->depth = depth;
+        p->ring->commit();
+    }
+
+    // Caller holds p->mutex.
+    void Drain(Profiler* p)
+    {
+        std::vector<uint32_t> stack;
+        while (const Sample* sample = p->ring->peek())
+        {
+            stack.assign(std::make_reverse_iterator(sample->frames + sample->depth), std::make_reverse_iterator(sample->frames));
+            p->counts[stack]++;
+            p->ring->pop();
+        }
+    }
+
+    void TimerLoop(Profiler* p, int hz)
+    {
+        auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / hz));
+        auto next = Clock::now() + period;
+
+        std::unique_lock lock(p->mutex);
+        while (!p->wake.wait_until(lock, next, [p] { return p->stopping; }))
+        {
+            // documented as safe to set from another thread; OnInterrupt clears it again
+            p->global->cb.interrupt = OnInterrupt;
+            Drain(p);
+
+            // after a stall, resume the rate instead of firing the missed ticks back to back
+            next = std::max(next + period, Clock::now());
+        }
+    }
+
+    void StopTimer(Profiler* p)
+    {
+        if (!p->timer.joinable())
+            return;
+
+        {
+            std::lock_guard lock(p->mutex);
+            p->stopping = true;
+        }
+        p->wake.notify_one();
+        p->timer.join();
+        p->stopping = false;
+
+        p->global->cb.interrupt = nullptr;
+    }
+
+    Profiler::~Profiler()
+    {
+        StopTimer(this);
+    }
+}
+
+namespace Profile {
+    int start(lua_State* L) {
+        int hz = luaL_optinteger(L, 1, 1000);
+        luaL_argcheck(L, hz >= 1 && hz <= 10000, 1, "rate must be between 1 and 10000 Hz");
+
+        sampling_profiler::start(L, hz);
+        return 0;
+    }
+
+    int stop(lua_State* L) {
+        sampling_profiler::stop(L);
+        return 0;
+    }
+
+    int dump(lua_State* L) {
+        std::string folded = sampling_profiler::dump(L);
+        lua_pushlstring(L, folded.data(), folded.size());
+        return 1;
+    }
+
+    int reset(lua_State* L) {
+        sampling_profiler::reset(L);
+        return 0;
+    }
+
+    int isrunning(lua_State* L) {
+        lua_pushboolean(L, sampling_profiler::running(L));
+        return 1;
+    }
+}
+
+void sampling_profiler::start(lua_State* L, int hz)
+{
+    Profiler* p = GetProfiler(L);
+    StopTimer(p);
+
+    p->global = L->global;
+    lua_callbacks(L)->userdata = p;
+    p->timer = std::thread(TimerLoop, p, hz);
+}
+
+void sampling_profiler::stop(lua_State* L)
+{
+    StopTimer(GetProfiler(L));
+}
+
+bool sampling_profiler::running(lua_State* L)
+{
+    return GetProfiler(L)->timer.joinable();
+}
+
+void sampling_profiler::reset(lua_State* L)
+{
+    Profiler* p = GetProfiler(L);
+
+    std::lock_guard lock(p->mutex);
+    Drain(p);
+    p->counts.clear();
+    p->dropped = 0;
+}
+
+std::string sampling_profiler::dump(lua_State* L)
+{
+    Profiler* p = GetProfiler(L);
+
+    std::lock_guard lock(p->mutex);
+    Drain(p);
+
+    std::string folded;
+    for (const auto& [stack, count] : p->counts)
+    {
+        for (size_t i = 0; i < stack.size(); i++)
+        {
+            if (i > 0)
+                folded += ';';
+            folded += p->names[stack[i]];
+        }
+        folded += ' ';
+        folded += std::to_string(count);
+        folded += '\n';
+    }
+
+    // samples lost to a full ring show up as their own stack rather than silently
+    if (uint64_t dropped = p->dropped.load(std::memory_order_relaxed))
+        folded += "(dropped) " + std::to_string(dropped) + "\n";
+
+    return folded;
+}
+
+void profiler_library::initialize(lua_State* L)
+{
+    lua_pushlightuserdata(L, &s_ProfilerKey);
+    void* storage = lua_newuserdatadtor(L, sizeof(Profiler), [](void* p) { static_cast<Profiler*>(p)->~Profiler(); });
+    new (storage) Profiler();
+    lua_rawset(L, LUA_REGISTRYINDEX);
+
+    lua_newtable(L);
+    NewTableFunction(L, "start", Profile::start);
+    NewTableFunction(L, "stop", Profile::stop);
+    NewTableFunction(L, "dump", Profile::dump);
+    NewTableFunction(L, "reset", Profile::reset);
+    NewTableFunction(L, "isrunning", Profile::isrunning);
+    lua_setreadonly(L, -1, true);
+    lua_setglobal(L, "profiler");
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "../../Includes.hpp"
+#include <string>
+struct lua_State;
+class profiler_library
+{
+public:
+	static void initialize(lua_State* L);
+};
+
+// Samples the call stack of a Luau state. A timer thread arms the state's interrupt callback at the
+// sampling rate; the callback records the running stack into a ring buffer and disarms itself, so
+// the VM runs at full speed between samples. One profiler per state, created by profiler_library.
+// Uses lua_callbacks(L)->interrupt and ->userdata while running. Interrupts fire at Luau safepoints
+// and GC steps, so time inside a C function is charged to its Luau caller unless a GC step runs there.
+class sampling_profiler
+{
+public:
+	// Starts (or changes the rate of) sampling; samples keep accumulating until reset.
+	static void start(lua_State* L, int hz = 1000);
+	static void stop(lua_State* L);
+	static bool running(lua_State* L);
+	static void reset(lua_State* L);
+
+	// Folded stacks ("root;caller;leaf count" per line), the input format of flamegraph tools.
+	static std::string dump(lua_State* L);
+};
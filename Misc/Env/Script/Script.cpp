@@ -38,55 +38,334 @@ int getrenv(lua_State* L) {
     return 1;
 }
 */
-int getgc(lua_State* L) {
-    luaL_trimstack(L, 1);
-    const bool includeTables = luaL_optboolean(L, 1, false);
+namespace
+{
+    // What getgc keeps. Checked while walking the heap, where nothing may allocate, so the strings are
+    // copied out of the filter table up front and the values to compare against stay on the Lua side.
+    struct GCFilter
+    {
+        uint32_t types = 0;     // bitmask of 1 << LUA_T*
+        std::string source;     // substring of a Luau function's chunk name
+        std::string name;       // exact function name
+        bool hasSource = false;
+        bool hasName = false;
+        bool hasMetatable = false;
+        bool hasUpvalue = false;
+        size_t limit = SIZE_MAX;
+        size_t batch = 0;       // 0 returns everything at once
+    };
 
-    lua_newtable(L);
-    lua_newtable(L);
+    // Upvalues of the batch iterator closure.
+    enum GCIteratorUpvalue { IteratorState = 1, IteratorMetatable, IteratorUpvalue, IteratorPin };
+
+    struct GCIterator
+    {
+        GCFilter filter;
+        lua_Page* page = nullptr; // where the next batch starts; kept alive by the pinned object
+        char* pos = nullptr;
+        size_t found = 0;
+        bool started = false;
+        bool done = false;
+    };
 
-    lua_pushstring(L, "kvs");
-    lua_setfield(L, -2, "__mode");
+    // A batch stops after this many objects even when few matched, so a sparse filter still hands
+    // control back to the script (and the collector) regularly.
+    constexpr size_t GCBatchWorkBudget = 64 * 1024;
 
-    lua_setmetatable(L, -2);
+    constexpr uint32_t GCTypeBit(int type)
+    {
+        return 1u << type;
+    }
 
-    typedef struct {
-        lua_State* luaThread;
-        bool includeTables;
-        int itemsFound;
-    } GCOContext;
+    constexpr uint32_t GCFirstClassTypes = GCTypeBit(LUA_TSTRING) | GCTypeBit(LUA_TTABLE) | GCTypeBit(LUA_TFUNCTION) |
+        GCTypeBit(LUA_TUSERDATA) | GCTypeBit(LUA_TTHREAD) | GCTypeBit(LUA_TBUFFER);
 
-    auto GCContext = GCOContext{ L, includeTables, 0 };
+    uint32_t GCTypeFromName(lua_State* L, int idx)
+    {
+        const char* name = luaL_checkstring(L, idx);
+        for (int type : {LUA_TSTRING, LUA_TTABLE, LUA_TFUNCTION, LUA_TUSERDATA, LUA_TTHREAD, LUA_TBUFFER}) {
+            if (strcmp(name, lua_typename(L, type)) == 0)
+                return GCTypeBit(type);
+        }
 
-    const auto oldGCThreshold = L->global->GCthreshold;
-    L->global->GCthreshold = SIZE_MAX;
+        luaL_error(L, "getgc: unknown type '%s'", name);
+    }
 
-    luaM_visitgco(L, &GCContext, [](void* ctx, lua_Page* page, GCObject* gcObj) -> bool {
-        const auto context = static_cast<GCOContext*>(ctx);
-        const auto luaThread = context->luaThread;
+    // Reads the filter table at idx. Leaves the metatable and upvalue to match (or nil) on the stack, in that order.
+    GCFilter ReadGCFilter(lua_State* L, int idx)
+    {
+        GCFilter filter;
+
+        lua_getfield(L, idx, "type");
+        if (lua_isstring(L, -1)) {
+            filter.types = GCTypeFromName(L, -1);
+        } else if (lua_istable(L, -1)) {
+            for (int i = 1, n = lua_objlen(L, -1); i <= n; i++) {
+                lua_rawgeti(L, -1, i);
+                filter.types |= GCTypeFromName(L, -1);
+                lua_pop(L, 1);
+            }
+        } else if (!lua_isnil(L, -1)) {
+            luaL_error(L, "getgc: type must be a string or an array of strings");
+        }
+        lua_pop(L, 1);
 
-        if (isdead(luaThread->global, gcObj))
-            return false;
+        lua_getfield(L, idx, "source");
+        if (const char* source = lua_tostring(L, -1)) {
+            filter.source = source;
+            filter.hasSource = true;
+        }
+        lua_getfield(L, idx, "name");
+        if (const char* name = lua_tostring(L, -1)) {
+            filter.name = name;
+            filter.hasName = true;
+        }
+        lua_getfield(L, idx, "limit");
+        if (!lua_isnil(L, -1))
+            filter.limit = size_t(std::max(0, luaL_checkinteger(L, -1)));
+        lua_getfield(L, idx, "batch");
+        if (!lua_isnil(L, -1))
+            filter.batch = size_t(std::max(1, luaL_checkinteger(L, -1)));
+        lua_pop(L, 4);
+
+        lua_getfield(L, idx, "metatable");
+        filter.hasMetatable = !lua_isnil(L, -1);
+        if (filter.hasMetatable)
+            luaL_argcheck(L, lua_istable(L, -1), idx, "metatable must be a table");
+
+        lua_getfield(L, idx, "upvalue");
+        filter.hasUpvalue = !lua_isnil(L, -1);
+
+        // without an explicit type, the other criteria say what can match
+        if (filter.types == 0) {
+            if (filter.hasMetatable)
+                filter.types = GCTypeBit(LUA_TTABLE) | GCTypeBit(LUA_TUSERDATA);
+            else if (filter.hasSource || filter.hasName || filter.hasUpvalue)
+                filter.types = GCTypeBit(LUA_TFUNCTION);
+            else
+                filter.types = GCTypeBit(LUA_TFUNCTION) | GCTypeBit(LUA_TTABLE) | GCTypeBit(LUA_TUSERDATA) | GCTypeBit(LUA_TTHREAD) |
+                    GCTypeBit(LUA_TBUFFER);
+        }
 
-        const auto gcObjectType = gcObj->gch.tt;
-        if (gcObjectType == LUA_TFUNCTION || gcObjectType == LUA_TTHREAD || gcObjectType == LUA_TUSERDATA ||
-            gcObjectType == LUA_TLIGHTUSERDATA ||
-            gcObjectType == LUA_TBUFFER || gcObjectType == LUA_TTABLE && context->includeTables) {
-            luaThread->top->value.gc = gcObj;
-            luaThread->top->tt = gcObjectType;
-            incr_top(luaThread);
+        return filter;
+    }
+
+    bool HasUpvalue(Closure* closure, const TValue* value)
+    {
+        for (int i = 0; i < closure->nupvalues; i++) {
+            const TValue* upvalue;
+            if (closure->isC) {
+                upvalue = &closure->c.upvals[i];
+            } else {
+                const TValue* ref = &closure->l.uprefs[i];
+                upvalue = ttisupval(ref) ? upvalue(ref)->v : ref;
+            }
 
-            const auto newTableIndex = context->itemsFound++;
-            lua_rawseti(luaThread, -2, newTableIndex);
+            if (luaO_rawequalObj(upvalue, value))
+                return true;
         }
 
         return false;
+    }
+
+    bool MatchesGCFilter(const GCFilter& filter, GCObject* gco, const TValue* metatable, const TValue* upvalue)
+    {
+        if (!(filter.types & GCTypeBit(gco->gch.tt)))
+            return false;
+
+        if (filter.hasMetatable) {
+            LuaTable* mt = gco->gch.tt == LUA_TTABLE ? gco->h.metatable : gco->gch.tt == LUA_TUSERDATA ? gco->u.metatable : nullptr;
+            if (!mt || mt != hvalue(metatable))
+                return false;
+        }
+
+        if (filter.hasSource || filter.hasName || filter.hasUpvalue) {
+            if (gco->gch.tt != LUA_TFUNCTION)
+                return false;
+
+            Closure* closure = &gco->cl;
+
+            if (filter.hasSource) {
+                if (closure->isC || !closure->l.p->source || !strstr(getstr(closure->l.p->source), filter.source.c_str()))
+                    return false;
+            }
+
+            if (filter.hasName) {
+                const char* name = closure->isC ? closure->c.debugname : closure->l.p->debugname ? getstr(closure->l.p->debugname) : nullptr;
+                if (!name || filter.name != name)
+                    return false;
+            }
+
+            if (filter.hasUpvalue && !HasUpvalue(closure, upvalue))
+                return false;
+        }
+
+        return true;
+    }
+
+    struct GCWalk
+    {
+        lua_State* L;
+        const GCFilter* filter;
+        const TValue* metatable;
+        const TValue* upvalue;
+        std::vector<GCObject*>* found;
+        size_t wanted;
+        size_t budget = SIZE_MAX; // objects to look at before giving up for now
+    };
+
+    // Walks from block pos of page (null for its first block) until enough matched or the budget ran
+    // out, leaving page and pos at the first block not yet looked at; page is null once the walk is done.
+    // Nothing is allocated, so the collector can't run underneath.
+    void WalkGC(GCWalk& walk, lua_Page*& page, char*& pos)
+    {
+        global_State* g = walk.L->global;
+        size_t visited = 0;
+
+        while (page) {
+            char* start;
+            char* end;
+            int busyBlocks;
+            int blockSize;
+            luaM_getpagewalkinfo(page, &start, &end, &busyBlocks, &blockSize);
+
+            // blocks are handed out downward from the end, so start only ever moves back
+            if (!pos || pos < start)
+                pos = start;
+
+            for (; pos != end && walk.found->size() < walk.wanted && visited < walk.budget; pos += blockSize) {
+                GCObject* gco = reinterpret_cast<GCObject*>(pos);
+                if (gco->gch.tt == LUA_TNIL) // free block
+                    continue;
+
+                visited++;
+                if (!isdead(g, gco) && MatchesGCFilter(*walk.filter, gco, walk.metatable, walk.upvalue))
+                    walk.found->push_back(gco);
+            }
+
+            if (pos != end)
+                return;
+
+            page = luaM_getnextpage(page);
+            pos = nullptr;
+        }
+    }
+
+    // A live first-class object on page, or null; holding one keeps the page from being freed.
+    GCObject* FindPinnable(lua_State* L, lua_Page* page)
+    {
+        struct Search { lua_State* L; GCObject* pin = nullptr; } search{L};
+
+        luaM_visitpage(page, &search, [](void* context, lua_Page*, GCObject* gco) -> bool {
+            Search* search = static_cast<Search*>(context);
+            if (!search->pin && (GCFirstClassTypes & GCTypeBit(gco->gch.tt)) && !isdead(search->L->global, gco))
+                search->pin = gco;
+            return false;
         });
 
-    L->global->GCthreshold = oldGCThreshold;
+        return search.pin;
+    }
+
+    int GCIteratorNext(lua_State* L)
+    {
+        GCIterator* it = static_cast<GCIterator*>(lua_touserdata(L, lua_upvalueindex(IteratorState)));
+        if (it->done || it->found >= it->filter.limit)
+            return 0;
+
+        const TValue* metatable = luaA_toobject(L, lua_upvalueindex(IteratorMetatable));
+        const TValue* upvalue = luaA_toobject(L, lua_upvalueindex(IteratorUpvalue));
+
+        std::vector<GCObject*> found;
+        GCWalk walk{L, &it->filter, metatable, upvalue, &found, std::min(it->filter.batch, it->filter.limit - it->found), GCBatchWorkBudget};
+
+        if (!it->started) {
+            it->page = L->global->allgcopages;
+            it->started = true;
+        }
+
+        WalkGC(walk, it->page, it->pos);
+
+        // a page with nothing first-class alive in it can't hold a match either
+        GCObject* pin = nullptr;
+        while (it->page && !(pin = FindPinnable(L, it->page))) {
+            it->page = luaM_getnextpage(it->page);
+            it->pos = nullptr;
+        }
+
+        it->done = it->page == nullptr;
+        it->found += found.size();
+
+        if (pin) {
+            luaC_threadbarrier(L);
+            L->top->value.gc = pin;
+            L->top->tt = pin->gch.tt;
+            incr_top(L);
+        } else {
+            lua_pushnil(L);
+        }
+        lua_replace(L, lua_upvalueindex(IteratorPin));
+
+        if (found.empty() && it->done)
+            return 0;
+
+        array_builder::push_objects(L, found);
+        return 1;
+    }
+}
+
+// getgc(includeTables?) returns a weak array of every function, userdata, thread and buffer (and
+// table). getgc(filter) returns only the matches: {type = "function" or {...}, source = substring,
+// name = exact name, metatable = t, upvalue = v, limit = n}. With batch = n it returns an iterator
+// instead, yielding arrays of up to n matches so the heap never has to be copied at once:
+//     for batch in getgc({type = "function", source = "Module", batch = 1000}) do ... end
+// A batch can come back short or empty when it ran out of its work budget.
+int getgc(lua_State* L) {
+    if (!lua_istable(L, 1)) {
+        luaL_trimstack(L, 1);
+
+        GCFilter filter;
+        filter.types = GCTypeBit(LUA_TFUNCTION) | GCTypeBit(LUA_TTHREAD) | GCTypeBit(LUA_TUSERDATA) | GCTypeBit(LUA_TBUFFER);
+        if (luaL_optboolean(L, 1, false))
+            filter.types |= GCTypeBit(LUA_TTABLE);
+
+        std::vector<GCObject*> found;
+        GCWalk walk{L, &filter, nullptr, nullptr, &found, SIZE_MAX};
+        lua_Page* page = L->global->allgcopages;
+        char* pos = nullptr;
+        WalkGC(walk, page, pos);
+
+        array_builder::push_objects(L, found);
+
+        lua_newtable(L);
+        lua_pushstring(L, "kvs");
+        lua_setfield(L, -2, "__mode");
+        lua_setmetatable(L, -2);
+
+        return 1;
+    }
+
+    lua_settop(L, 1);
+    GCFilter filter = ReadGCFilter(L, 1); // pushes metatable, upvalue
+
+    if (filter.batch == 0) {
+        std::vector<GCObject*> found;
+        GCWalk walk{L, &filter, luaA_toobject(L, 2), luaA_toobject(L, 3), &found, filter.limit};
+        lua_Page* page = L->global->allgcopages;
+        char* pos = nullptr;
+        WalkGC(walk, page, pos);
+
+        array_builder::push_objects(L, found);
+        return 1;
+    }
+
+    void* storage = lua_newuserdatadtor(L, sizeof(GCIterator), [](void* p) { static_cast<GCIterator*>(p)->~GCIterator(); });
+    new (storage) GCIterator{filter};
+    lua_replace(L, 1);
 
+    lua_pushnil(L); // pin
+    lua_pushcclosurek(L, GCIteratorNext, "getgc_iterator", 4, nullptr);
     return 1;
-};
+}
 
 int getreg(lua_State* L) {
     luaL_trimstack(L, 0);
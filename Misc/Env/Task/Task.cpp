@@ -0,0 +1,411 @@
+#include "Task.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+
+namespace
+{
+    struct Posted
+    {
+        lua_State* thread;
+        uint64_t seq;
+        task_scheduler::completion done;
+    };
+}
+
+// Completions posted by worker threads, drained by the run loop on the VM thread.
+
+struct task_scheduler::mailbox
+{
+    std::mutex mutex;
+    std::condition_variable posted;
+    std::vector<Posted> items;
+};
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Sleeper
+    {
+        double wake;
+        uint64_t seq;
+        lua_State* thread;
+
+        bool operator>(const Sleeper& other) const
+        {
+            return wake != other.wake ? wake > other.wake : seq > other.seq;
+        }
+    };
+
+    // A thread has at most one pending resumption; heap and queue entries whose seq no longer
+    // matches were superseded or cancelled and are skipped when they come up.
+    struct Parked
+    {
+        uint64_t seq;
+        int ref;        // keeps the thread alive while parked
+        int nargs;      // already on the thread's stack
+        bool elapsed;   // task.wait: resume with the time slept instead
+        double since;
+    };
+
+    struct Scheduler
+    {
+        std::priority_queue<Sleeper, std::vector<Sleeper>, std::greater<Sleeper>> timers;
+        std::deque<std::pair<lua_State*, uint64_t>> deferred;
+        std::unordered_map<lua_State*, Parked> parked;
+        uint64_t nextseq = 0;
+
+        std::shared_ptr<task_scheduler::mailbox> mailbox = std::make_shared<task_scheduler::mailbox>();
+        size_t external = 0; // parks still waiting on complete()
+        size_t errors = 0;   // reported by resumed threads
+
+        bool fakeclock = false;
+        double fakenow = 0.0;
+        Clock::time_point epoch = Clock::now();
+    };
+
+    char s_SchedulerKey;
+
+    Scheduler* GetScheduler(lua_State* L)
+    {
+        lua_pushlightuserdata(L, &s_SchedulerKey);
+        lua_rawget(L, LUA_REGISTRYINDEX);
+        Scheduler* scheduler = static_cast<Scheduler*>(lua_touserdata(L, -1));
+        lua_pop(L, 1);
+
+        LUAU_ASSERT(scheduler);
+        return scheduler;
+    }
+
+    double Now(Scheduler* s)
+    {
+        if (s->fakeclock)
+            return s->fakenow;
+
+        return std::chrono::duration<double>(Clock::now() - s->epoch).count();
+    }
+
+    void Unpark(lua_State* L, Scheduler* s, lua_State* thread)
+    {
+        auto it = s->parked.find(thread);
+        if (it == s->parked.end())
+            return;
+
+        lua_unref(L, it->second.ref);
+        s->parked.erase(it);
+    }
+
+    // thread must be at index idx of L; its resume arguments are already on its own stack.
+    // wake -1 defers to the next scheduler pass, -2 waits for an external completion.
+    void Park(lua_State* L, Scheduler* s, int idx, lua_State* thread, int nargs, bool elapsed, double wake)
+    {
+        Unpark(L, s, thread);
+
+        uint64_t seq = s->nextseq++;
+        s->parked[thread] = Parked{seq, lua_ref(L, idx), nargs, elapsed, Now(s)};
+
+        if (wake == -1.0)
+            s->deferred.emplace_back(thread, seq);
+        else if (wake >= 0)
+            s->timers.push(Sleeper{wake, seq, thread});
+    }
+
+    void ResumeParked(lua_State* L, Scheduler* s, lua_State* thread, uint64_t seq, const task_scheduler::completion& done = nullptr)
+    {
+        auto it = s->parked.find(thread);
+        if (it == s->parked.end() || it->second.seq != seq)
+            return;
+
+        Parked parked = it->second;
+        s->parked.erase(it);
+
+        int nargs = parked.nargs;
+        if (parked.elapsed)
+        {
+            lua_pushnumber(thread, Now(s) - parked.since);
+            nargs = 1;
+        }
+
+        // the ref keeps the thread alive until it is done running
+        if (done)
+        {
+            nargs = done(thread);
+            if (nargs < 0)
+            {
+                int status = lua_resumeerror(thread, L);
+                if (status != LUA_OK && status != LUA_YIELD)
+                {
+                    const char* message = lua_tostring(thread, -1);
+                    std::cerr << "Error in task: " << (message ? message : "(error object is not a string)") << std::endl;
+                    s->errors++;
+                }
+                lua_unref(L, parked.ref);
+                return;
+            }
+        }
+
+        task_scheduler::resume(L, thread, nargs);
+        lua_unref(L, parked.ref);
+    }
+
+    void DrainMailbox(lua_State* L, Scheduler* s)
+    {
+        std::vector<Posted> items;
+        {
+            std::lock_guard lock(s->mailbox->mutex);
+            items.swap(s->mailbox->items);
+        }
+
+        for (Posted& item : items)
+        {
+            s->external--;
+            ResumeParked(L, s, item.thread, item.seq, item.done);
+        }
+    }
+
+    // Accepts a function or a thread at index 1; a function gets a fresh thread. Leaves the thread
+    // at index 1 and moves the remaining arguments onto it.
+    lua_State* PrepareThread(lua_State* L)
+    {
+        lua_State* thread = nullptr;
+
+        if (lua_isfunction(L, 1))
+        {
+            thread = lua_newthread(L);
+            lua_pushvalue(L, 1);
+            lua_xmove(L, thread, 1);
+            lua_replace(L, 1);
+        }
+        else if (lua_isthread(L, 1))
+        {
+            thread = lua_tothread(L, 1);
+        }
+        else
+        {
+            luaL_typeerrorL(L, 1, "function or thread");
+        }
+
+        int nargs = lua_gettop(L) - 1;
+        if (nargs > 0)
+        {
+            lua_checkstack(thread, nargs);
+            lua_xmove(L, thread, nargs);
+        }
+
+        return thread;
+    }
+}
+
+namespace Task {
+    int spawn(lua_State* L) {
+        int nargs = lua_gettop(L) - 1;
+        lua_State* thread = PrepareThread(L);
+
+        if (lua_costatus(L, thread) != LUA_COSUS) {
+            lua_pop(thread, nargs);
+            luaL_error(L, "cannot spawn non-suspended coroutine");
+        }
+
+        Unpark(L, GetScheduler(L), thread);
+        task_scheduler::resume(L, thread, nargs);
+
+        lua_settop(L, 1);
+        return 1;
+    }
+
+    int defer(lua_State* L) {
+        int nargs = lua_gettop(L) - 1;
+        lua_State* thread = PrepareThread(L);
+
+        Park(L, GetScheduler(L), 1, thread, nargs, false, -1.0);
+
+        lua_settop(L, 1);
+        return 1;
+    }
+
+    int delay(lua_State* L) {
+        double seconds = luaL_optnumber(L, 1, 0.0);
+        lua_remove(L, 1);
+
+        int nargs = lua_gettop(L) - 1;
+        lua_State* thread = PrepareThread(L);
+
+        Scheduler* s = GetScheduler(L);
+        Park(L, s, 1, thread, nargs, false, Now(s) + (seconds > 0 ? seconds : 0));
+
+        lua_settop(L, 1);
+        return 1;
+    }
+
+    int wait(lua_State* L) {
+        double seconds = luaL_optnumber(L, 1, 0.0);
+
+        if (!lua_isyieldable(L))
+            luaL_error(L, "task.wait can't yield from this context");
+
+        Scheduler* s = GetScheduler(L);
+
+        lua_pushthread(L);
+        Park(L, s, -1, L, 0, true, Now(s) + (seconds > 0 ? seconds : 0));
+        lua_pop(L, 1);
+
+        return lua_yield(L, 0);
+    }
+
+    int cancel(lua_State* L) {
+        luaL_checktype(L, 1, LUA_TTHREAD);
+        Unpark(L, GetScheduler(L), lua_tothread(L, 1));
+        return 0;
+    }
+}
+
+int task_scheduler::resume(lua_State* from, lua_State* thread, int nargs)
+{
+    if (lua_costatus(from, thread) != LUA_COSUS)
+    {
+        lua_pop(thread, nargs);
+        std::cerr << "task: cannot resume " << (thread == from ? "running" : "dead") << " thread" << std::endl;
+        return LUA_ERRRUN;
+    }
+
+    int status = lua_resume(thread, from, nargs);
+
+    if (status != LUA_OK && status != LUA_YIELD)
+    {
+        const char* message = lua_tostring(thread, -1);
+        std::cerr << "Error in task: " << (message ? message : "(error object is not a string)") << std::endl;
+        GetScheduler(from)->errors++;
+    }
+
+    return status;
+}
+
+size_t task_scheduler::error_count(lua_State* L)
+{
+    return GetScheduler(L)->errors;
+}
+
+void task_scheduler::run(lua_State* L)
+{
+    Scheduler* s = GetScheduler(L);
+
+    for (;;)
+    {
+        // only what was queued before this pass, a thread that keeps deferring itself can't starve timers
+        uint64_t passseq = s->nextseq;
+
+        DrainMailbox(L, s);
+
+        for (size_t count = s->deferred.size(); count > 0 && !s->deferred.empty(); count--)
+        {
+            auto [thread, seq] = s->deferred.front();
+            s->deferred.pop_front();
+            ResumeParked(L, s, thread, seq);
+        }
+
+        double now = Now(s);
+        while (!s->timers.empty() && s->timers.top().wake <= now && s->timers.top().seq < passseq)
+        {
+            Sleeper sleeper = s->timers.top();
+            s->timers.pop();
+            ResumeParked(L, s, sleeper.thread, sleeper.seq);
+        }
+
+        // drop superseded timers so they don't hold up the sleep below
+        while (!s->timers.empty())
+        {
+            auto it = s->parked.find(s->timers.top().thread);
+            if (it != s->parked.end() && it->second.seq == s->timers.top().seq)
+                break;
+            s->timers.pop();
+        }
+
+        if (!s->deferred.empty())
+            continue;
+
+        if (s->timers.empty() && s->external == 0)
+            break;
+
+        std::unique_lock lock(s->mailbox->mutex);
+        auto hasmail = [s] { return !s->mailbox->items.empty(); };
+
+        if (s->timers.empty())
+        {
+            s->mailbox->posted.wait(lock, hasmail);
+        }
+        else
+        {
+            double wake = s->timers.top().wake;
+            if (s->fakeclock)
+                s->fakenow = std::max(s->fakenow, wake);
+            else if (wake > Now(s))
+                s->mailbox->posted.wait_until(lock, s->epoch + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(wake)), hasmail);
+        }
+    }
+}
+
+task_scheduler::ticket task_scheduler::park_external(lua_State* L)
+{
+    Scheduler* s = GetScheduler(L);
+
+    lua_pushthread(L);
+    Park(L, s, -1, L, 0, false, -2.0);
+    lua_pop(L, 1);
+
+    s->external++;
+    return ticket{s->mailbox, L, s->parked[L].seq};
+}
+
+void task_scheduler::complete(const ticket& ticket, completion done)
+{
+    {
+        std::lock_guard lock(ticket.box->mutex);
+        ticket.box->items.push_back(Posted{ticket.thread, ticket.seq, std::move(done)});
+    }
+
+    ticket.box->posted.notify_one();
+}
+
+void task_scheduler::set_fake_clock(lua_State* L, bool enabled)
+{
+    Scheduler* s = GetScheduler(L);
+    if (s->fakeclock == enabled)
+        return;
+
+    double now = Now(s);
+    s->fakeclock = enabled;
+
+    // keep time monotonic across the switch
+    if (enabled)
+        s->fakenow = now;
+    else
+        s->epoch = Clock::now() - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(now));
+}
+
+double task_scheduler::now(lua_State* L)
+{
+    return Now(GetScheduler(L));
+}
+
+void task_library::initialize(lua_State* L)
+{
+    lua_pushlightuserdata(L, &s_SchedulerKey);
+    void* storage = lua_newuserdatadtor(L, sizeof(Scheduler), [](void* p) { static_cast<Scheduler*>(p)->~Scheduler(); });
+    new (storage) Scheduler();
+    lua_rawset(L, LUA_REGISTRYINDEX);
+
+    lua_newtable(L);
+    NewTableFunction(L, "spawn", Task::spawn);
+    NewTableFunction(L, "defer", Task::defer);
+    NewTableFunction(L, "delay", Task::delay);
+    NewTableFunction(L, "wait", Task::wait);
+    NewTableFunction(L, "cancel", Task::cancel);
+    lua_setreadonly(L, -1, true);
+    lua_setglobal(L, "task");
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "../../Includes.hpp"
+#include <functional>
+#include <memory>
+struct lua_State;
+class task_library
+{
+public:
+	static void initialize(lua_State* L);
+};
+
+// Owns the threads parked by task.wait/defer/delay. One scheduler per Luau state, created by
+// task_library::initialize; sleepers sit in a min-heap keyed by wake time.
+class task_scheduler
+{
+public:
+	// Runs on the VM thread when off-thread work finishes: pushes the thread's resume values and
+	// returns how many, or pushes an error object and returns -1 to resume the thread with an error.
+	using completion = std::function<int(lua_State* thread)>;
+
+	struct mailbox;
+
+	// Identifies one external park. Safe to copy to and complete from any OS thread; the mailbox is
+	// shared so completing after the state closed is harmless.
+	struct ticket
+	{
+		std::shared_ptr<mailbox> box;
+		lua_State* thread = nullptr;
+		uint64_t seq = 0;
+	};
+
+	// Parks the running thread until complete() is called for the ticket; yield right after.
+	static ticket park_external(lua_State* L);
+	static void complete(const ticket& ticket, completion done);
+
+	// Resumes thread with the top nargs values of its stack as arguments. Errors are reported, not raised.
+	static int resume(lua_State* from, lua_State* thread, int nargs);
+	// How many errors resumed threads have reported so far.
+	static size_t error_count(lua_State* L);
+
+	// Runs deferred, due and completed threads until nothing is parked, sleeping while waiting on timers or workers.
+	static void run(lua_State* L);
+
+	// With the fake clock, time only moves when the run loop jumps to the next wake time, so runs are reproducible.
+	static void set_fake_clock(lua_State* L, bool enabled);
+	static double now(lua_State* L);
+};
@@ -1,23 +1,140 @@
 #include "Environment.hpp"
 
+// Each library's tables and closures are charged to a memory category of its own.
+static void initializeLibrary(lua_State* L, const char* name, void (*initialize)(lua_State*)) {
+    lua_setmemcat(L, memory_stats::category(L, name));
+    initialize(L);
+    lua_setmemcat(L, 0);
+}
+
+lua_State* environment::create_state(bool quiet)
+{
+    host_allocator* allocator = host_allocator::create(host_allocator::get_default());
+    lua_State* L = lua_newstate(host_allocator::allocate, allocator);
+    if (!L) {
+        host_allocator::destroy(allocator);
+        return nullptr;
+    }
+
+    memory_stats::attach(L);
+
+    s_ListRegistrations = !quiet;
+    initializeLibrary(L, "stdlib", luaL_openlibs); //open debug, math, os and etc libs. 
+    initialize(L);
+    s_ListRegistrations = true;
+
+    // SPARK_FAKE_CLOCK=1 makes task timings deterministic: the clock jumps to the next wake time instead of sleeping.
+    if (const char* fakeClock = std::getenv("SPARK_FAKE_CLOCK"); fakeClock && std::strcmp(fakeClock, "0") != 0) {
+        task_scheduler::set_fake_clock(L, true);
+    }
+
+    return L;
+}
+
+void environment::close_state(lua_State* L)
+{
+    host_allocator* allocator = static_cast<host_allocator*>(L->global->ud);
+    lua_close(L);
+    host_allocator::destroy(allocator); // whatever the state still held goes back here in bulk
+}
+
+static bool isShared(lua_State* L)
+{
+    bool shared = lua_getfield(L, LUA_REGISTRYINDEX, "_SHAREDTABLES") != LUA_TNIL;
+    lua_pop(L, 1);
+    return shared;
+}
+
+// The tables luaL_sandbox froze: the globals, the tables in them and the string metatable. A job may freeze
+// and thaw tables of its own; these stay frozen.
+static bool isSharedTable(lua_State* L, int idx)
+{
+    idx = lua_absindex(L, idx);
+    lua_getfield(L, LUA_REGISTRYINDEX, "_SHAREDTABLES");
+    lua_pushvalue(L, idx);
+    bool shared = lua_rawget(L, -2) != LUA_TNIL;
+    lua_pop(L, 2);
+    return shared;
+}
+
+void environment::share(lua_State* L)
+{
+    luaL_sandbox(L);
+
+    lua_newtable(L);
+
+    lua_pushvalue(L, LUA_GLOBALSINDEX);
+    lua_pushboolean(L, true);
+    lua_rawset(L, -3);
+
+    lua_pushnil(L);
+    while (lua_next(L, LUA_GLOBALSINDEX) != 0) {
+        if (lua_istable(L, -1)) {
+            lua_pushboolean(L, true);
+            lua_rawset(L, -4);
+        } else {
+            lua_pop(L, 1);
+        }
+    }
+
+    lua_pushliteral(L, "");
+    if (lua_getmetatable(L, -1)) {
+        lua_pushboolean(L, true);
+        lua_rawset(L, -4);
+    }
+    lua_pop(L, 1);
+
+    lua_setfield(L, LUA_REGISTRYINDEX, "_SHAREDTABLES");
+}
+
+void environment::check_unshared(lua_State* L, int idx, const char* what)
+{
+    if (!isShared(L))
+        return;
+
+    bool frozen = false;
+    switch (lua_type(L, idx)) {
+    case LUA_TTABLE:
+        frozen = isSharedTable(L, idx);
+        break;
+    case LUA_TFUNCTION:
+        return check_unshared(L, clvalue(luaA_toobject(L, idx)), what);
+    case LUA_TUSERDATA:
+        break;
+    default:
+        frozen = true;
+        break;
+    }
+
+    if (frozen)
+        luaL_error(L, "%s: cannot modify a value shared by every job on this state", what);
+}
+
+void environment::check_unshared(lua_State* L, const Closure* cl, const char* what)
+{
+    if (isShared(L) && cl->env && cl->env->readonly)
+        luaL_error(L, "%s: cannot modify a function shared by every job on this state", what);
+}
 
 void environment::initialize(lua_State* L)
 {
-    closure_library::initialize(L); //Soo many errors
-    script_library::initialize(L);
+    initializeLibrary(L, "closure", closure_library::initialize); //Soo many errors
+    initializeLibrary(L, "script", script_library::initialize);
     //http_library::initialize(L);
-    debug_library::initialize(L);
+    initializeLibrary(L, "debug", debug_library::initialize);
     //lz4_library::initialize(L);
     //filesystem_library::initialize(L);
     //crypt_library::initialize(L);
     //cache_library::initialize(L);
-    metatable_library::initialize(L);
+    initializeLibrary(L, "metatable", metatable_library::initialize);
     //reflection_library::initialize(L);
     //websocket_library::initialize(L);
     //instance_library::initialize(L);
     //signal_library::initialize(L);
 
-    misc_library::initialize(L);
+    initializeLibrary(L, "misc", misc_library::initialize);
+    initializeLibrary(L, "task", task_library::initialize);
+    initializeLibrary(L, "profiler", profiler_library::initialize);
 
 	//hooks::initialize(L);
 
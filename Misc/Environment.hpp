@@ -8,9 +8,26 @@
 #include "Env/Closure/Closure.hpp"
 #include "Env/Script/Script.hpp"
 #include "Env/Misc/Misc.hpp"
+#include "Env/Task/Task.hpp"
+#include "Env/Profiler/Profiler.hpp"
 #include <lua.h>
 class environment
 {
 public:
 	static void initialize(lua_State* l);
+
+	// A fresh state with the standard libraries and our functions, honouring SPARK_FAKE_CLOCK. Each
+	// function registered is listed on stdout unless quiet.
+	static lua_State* create_state(bool quiet = false);
+	// Closes the state (any of its threads will do) and releases its allocator.
+	static void close_state(lua_State* L);
+
+	// Freezes the state for the jobs that will run on it: luaL_sandbox makes its globals and libraries
+	// read-only, and from then on check_unshared refuses the functions that write in place anyway.
+	static void share(lua_State* L);
+	// In a shared state, raises an error when the value at idx belongs to the frozen part: a table that
+	// share froze, a function whose environment is read-only (the frozen globals), or a value of a type
+	// whose metatable every thread shares. Jobs' own tables, closures and userdata pass.
+	static void check_unshared(lua_State* L, int idx, const char* what);
+	static void check_unshared(lua_State* L, const struct Closure* cl, const char* what);
 };
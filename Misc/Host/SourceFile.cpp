@@ -0,0 +1,120 @@
+#include "SourceFile.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    // Pipes are read this much at a time; the buffer doubles as it fills, and realloc moves large
+    // buffers by remapping pages rather than copying them.
+    constexpr size_t kReadBlock = 1 << 20;
+}
+
+source_file::~source_file()
+{
+    release();
+}
+
+void source_file::release()
+{
+    if (mapping)
+        munmap(mapping, mapped);
+    std::free(buffer);
+
+    mapping = nullptr;
+    mapped = 0;
+    buffer = nullptr;
+    data = nullptr;
+    size = 0;
+}
+
+bool source_file::map(int fd, size_t offset, size_t length)
+{
+    if (offset >= length) {
+        data = "";
+        size = 0;
+        return true;
+    }
+
+    // the whole file is faulted in up front, which is what parsing it would do page by page
+    void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    if (p == MAP_FAILED)
+        return false;
+
+    mapping = p;
+    mapped = length;
+    data = static_cast<const char*>(p) + offset;
+    size = length - offset;
+    return true;
+}
+
+bool source_file::open(const char* path)
+{
+    release();
+
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    bool ok = fstat(fd, &info) == 0;
+    if (ok && !S_ISREG(info.st_mode)) {
+        ok = read(fd);
+    } else if (ok) {
+        ok = map(fd, 0, size_t(info.st_size));
+    }
+
+    int error = errno;
+    close(fd);
+    errno = error;
+    return ok;
+}
+
+bool source_file::read(int fd)
+{
+    release();
+
+    // stdin may already be partly consumed; the mapping starts wherever reading would
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+        off_t offset = lseek(fd, 0, SEEK_CUR);
+        if (offset >= 0 && map(fd, size_t(offset), size_t(info.st_size)))
+            return true;
+    }
+
+    size_t capacity = 0;
+    size_t used = 0;
+    for (;;) {
+        if (capacity - used < kReadBlock) {
+            size_t grown = std::max(capacity * 2, used + kReadBlock);
+            char* p = static_cast<char*>(std::realloc(buffer, grown));
+            if (!p) {
+                errno = ENOMEM;
+                return false;
+            }
+            buffer = p;
+            capacity = grown;
+        }
+
+        ssize_t count = ::read(fd, buffer + used, capacity - used);
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        if (count == 0)
+            break;
+
+        used += size_t(count);
+    }
+
+    data = buffer;
+    size = used;
+    return true;
+}
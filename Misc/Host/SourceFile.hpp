@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+
+// Script source held for compiling: a read-only mapping when it comes from a regular file, or the
+// bytes read from a pipe in large blocks. The compiler parses straight from view(), so the source
+// is never copied after it has been read.
+class source_file
+{
+public:
+	source_file() = default;
+	~source_file();
+
+	source_file(const source_file&) = delete;
+	source_file& operator=(const source_file&) = delete;
+
+	// Maps the file at path. On failure returns false with errno set.
+	bool open(const char* path);
+
+	// Takes everything left to read on fd: mapped when fd is a regular file (stdin redirected from
+	// one), read until end of file otherwise. On failure returns false with errno set.
+	bool read(int fd);
+
+	std::string_view view() const { return std::string_view(data, size); }
+
+private:
+	void* mapping = nullptr;
+	size_t mapped = 0;
+	char* buffer = nullptr; // malloc'd, when read from a pipe
+
+	const char* data = nullptr;
+	size_t size = 0;
+
+	bool map(int fd, size_t offset, size_t length);
+	void release();
+};
@@ -0,0 +1,222 @@
+#include "WorkerHost.hpp"
+#include "../Environment.hpp"
+#include "../Env/Profiler/Profiler.hpp"
+#include "SourceFile.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+    // The job list is fixed before the workers start, so a shared cursor is the whole queue: claiming
+    // a job is one fetch_add, with no lock for workers to contend on.
+    struct JobQueue
+    {
+        const std::vector<std::string>& jobs;
+        std::atomic<size_t> next{0};
+
+        const std::string* Take()
+        {
+            size_t index = next.fetch_add(1, std::memory_order_relaxed);
+            return index < jobs.size() ? &jobs[index] : nullptr;
+        }
+    };
+
+    std::mutex s_OutputMutex;
+
+    void ReportError(const std::string& path, const char* what, const char* message)
+    {
+        std::lock_guard lock(s_OutputMutex);
+        std::cerr << path << ": " << what << ": " << (message ? message : "(error object is not a string)") << std::endl;
+    }
+
+    // Loads and runs one script on a new thread of LS, then drives the scheduler until its tasks finish.
+    bool RunScript(lua_State* LS, const std::string& path, bool sandbox)
+    {
+        source_file source;
+        if (!source.open(path.c_str())) {
+            ReportError(path, "cannot read", std::strerror(errno));
+            return false;
+        }
+
+        lua_State* L = lua_newthread(LS);
+        if (sandbox)
+            luaL_sandboxthread(L);
+
+        std::string chunkname = "@" + path;
+        bool ok = true;
+
+        // everything the job allocates is charged to its own memory category; a job's is given back when
+        // it ends, while the init script's globals stay for the worker's lifetime
+        int category = memory_stats::category(L, chunkname.c_str());
+        lua_setmemcat(L, category);
+
+        if (compiler::load(L, chunkname.c_str(), source.view()) != LUA_OK) {
+            ReportError(path, "load failed", lua_tostring(L, -1));
+            ok = false;
+        } else {
+            size_t taskerrors = task_scheduler::error_count(LS);
+
+            int status = lua_resume(L, LS, 0);
+            if (status != LUA_OK && status != LUA_YIELD) {
+                ReportError(path, "error", lua_tostring(L, -1));
+                ok = false;
+            }
+
+            // errors in the job's tasks, including its own body after a yield, were reported as they happened
+            task_scheduler::run(LS);
+            if (task_scheduler::error_count(LS) != taskerrors)
+                ok = false;
+        }
+
+        lua_pop(LS, 1); // the thread
+        if (sandbox)
+            memory_stats::release(LS, category);
+        return ok;
+    }
+
+    void Work(JobQueue& queue, const std::string& init, std::atomic<size_t>& failed)
+    {
+        // quiet, or every worker would list the functions it registers in among the jobs' output
+        lua_State* LS = environment::create_state(true);
+        if (!LS) {
+            ReportError("worker", "cannot create state", nullptr);
+            while (queue.Take())
+                failed.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        // unsandboxed, so what it defines is visible to every job on this worker
+        if (!init.empty())
+            RunScript(LS, init, false);
+
+        // jobs share the globals and libraries read-only, writing globals into their own thread's table
+        environment::share(LS);
+
+        size_t localfailed = 0;
+        while (const std::string* job = queue.Take()) {
+            if (!RunScript(LS, *job, true))
+                localfailed++;
+        }
+
+        failed.fetch_add(localfailed, std::memory_order_relaxed);
+
+        if (std::getenv("SPARK_MEMSTATS")) {
+            std::lock_guard lock(s_OutputMutex);
+            memory_stats::print(LS, std::cerr, 10);
+        }
+
+        environment::close_state(LS);
+    }
+
+    // A child inherits the template's memory but only the forking thread. The yielder pool that init
+    // may have started is rebuilt by the child on first use; a running profiler is stopped here,
+    // since its timer thread would not come along.
+    size_t RunForked(const std::vector<std::string>& jobs, size_t count, const std::string& init)
+    {
+        lua_State* LS = environment::create_state(true);
+        if (!LS) {
+            ReportError("template", "cannot create state", nullptr);
+            return jobs.size();
+        }
+
+        if (!init.empty())
+            RunScript(LS, init, false);
+
+        if (sampling_profiler::running(LS))
+            sampling_profiler::stop(LS);
+
+        // the same read-only view of the template that threaded workers give their jobs
+        environment::share(LS);
+
+        // children start from a collected heap instead of each finishing the template's cycle
+        lua_gc(LS, LUA_GCCOLLECT, 0);
+
+        // anything still buffered would be written again by every child
+        std::cout.flush();
+        std::fflush(stdout);
+
+        size_t failed = 0;
+        size_t running = 0;
+        size_t next = 0;
+        while (next < jobs.size() || running > 0) {
+            if (next < jobs.size() && running < count) {
+                const std::string& job = jobs[next++];
+
+                pid_t pid = fork();
+                if (pid == 0) {
+                    bool ok = RunScript(LS, job, true);
+                    std::cout.flush();
+                    std::fflush(stdout);
+                    _exit(ok ? 0 : 1); // the OS takes the state back; closing it would only touch every copied page
+                }
+
+                if (pid < 0) {
+                    ReportError(job, "cannot fork", std::strerror(errno));
+                    failed++;
+                } else {
+                    running++;
+                }
+                continue;
+            }
+
+            int status = 0;
+            if (waitpid(-1, &status, 0) < 0) {
+                if (errno == EINTR)
+                    continue;
+                ReportError("worker", "wait failed", std::strerror(errno));
+                failed += running;
+                break;
+            }
+
+            running--;
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                failed++;
+        }
+
+        environment::close_state(LS);
+        return failed;
+    }
+}
+
+worker_host::report worker_host::run(const std::vector<std::string>& jobs, const options& options)
+{
+    size_t count = options.workers > 0 ? options.workers : 1;
+
+    JobQueue queue{jobs};
+    std::atomic<size_t> failed{0};
+
+    auto start = std::chrono::steady_clock::now();
+
+    if (options.fork) {
+        report result;
+        result.workers = count;
+        result.jobs = jobs.size();
+        result.failed = RunForked(jobs, count, options.init);
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(count);
+    for (size_t i = 0; i < count; i++)
+        workers.emplace_back(Work, std::ref(queue), std::cref(options.init), std::ref(failed));
+
+    for (std::thread& worker : workers)
+        worker.join();
+
+    report result;
+    result.workers = count;
+    result.jobs = jobs.size();
+    result.failed = failed.load();
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
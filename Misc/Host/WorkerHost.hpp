@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Runs many independent scripts across cores. Each worker thread owns one Luau state for its whole
+// life and takes jobs from a shared queue; states never cross threads, so nothing in the VM is shared.
+// With options::fork the workers are processes forked from one template state instead.
+class worker_host
+{
+public:
+	struct options
+	{
+		size_t workers = 1;
+		std::string init; // script run once in each worker state before its first job, for shared setup
+
+		// Builds one state (and runs init) up front, then runs each job in a child process forked from
+		// it, up to `workers` at a time. Jobs start on the template's pages copy-on-write instead of
+		// creating a state, and nothing a job does reaches the template or the next job. A profiler the
+		// init script starts is stopped before the first fork; jobs can start their own.
+		bool fork = false;
+	};
+
+	struct report
+	{
+		size_t workers = 0;
+		size_t jobs = 0;
+		size_t failed = 0;  // failed to load, or raised an error at top level or in one of its tasks
+		double seconds = 0; // wall time from the first state being created to the last job finishing
+	};
+
+	// Each job is the path of a script. A job runs in its own sandboxed thread, so globals it sets
+	// don't leak into the next job on that worker; after init, the state's globals and library
+	// tables are read-only, and setreadonly, setrawmetatable, hookfunction, setupvalue and
+	// setconstant refuse to change them (environment::share). Task work a job starts is finished
+	// before the next.
+	//
+	// Threaded workers keep jobs apart, but they don't contain hostile ones: jobs on a worker share
+	// one heap and registry, which getreg and getgc reach. Jobs that must not affect each other at
+	// all belong in options::fork, where each one gets a copy of the template and exits.
+	static report run(const std::vector<std::string>& jobs, const options& options);
+};
@@ -14,6 +14,10 @@
 #include <unordered_set>
 
 #include "Yield/Yielder.hpp"
+#include "Compile/Compiler.hpp"
+#include "Table/ArrayBuilder.hpp"
+#include "Memory/HostAllocator.hpp"
+#include "Memory/MemoryStats.hpp"
 //#include "Hook/Hook.hpp" //exploit anti-exploit shit :skull:
 
 #include <cstring>
@@ -64,18 +68,21 @@ incr_top(L)
 
 
 
-static void NewTableFunction(lua_State* L, const char* globalname, lua_CFunction function) {
-    lua_pushcclosurek(L, function, nullptr, 0, nullptr);
+// Whether registrations are listed on stdout; environment::create_state turns it off for quiet states.
+inline thread_local bool s_ListRegistrations = true;
+
+// nup values on top of the stack become the function's upvalues.
+static void NewTableFunction(lua_State* L, const char* globalname, lua_CFunction function, int nup = 0) {
+    lua_pushcclosurek(L, function, nullptr, nup, nullptr);
     lua_setfield(L, -2, globalname);
-    std::cout << globalname<<std::endl;
+    if (s_ListRegistrations)
+        std::cout << globalname << '\n';
 }
 
 static void NewFunction(lua_State* L, const char* globalname, lua_CFunction function)
 {
     lua_pushcclosurek(L, function, nullptr, 0, nullptr);
     lua_setglobal(L, globalname);
-    std::cout<<globalname<<std::endl;
-}
-
-//#define luau_compileW luau_compile
-inline char* luau_compileW(const char* source, size_t size, lua_CompileOptions* options, size_t* outsize, std::string* ErrMsg);
\ No newline at end of file
+    if (s_ListRegistrations)
+        std::cout << globalname << '\n';
+}
\ No newline at end of file
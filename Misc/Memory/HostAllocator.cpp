@@ -0,0 +1,376 @@
+#include "HostAllocator.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/mman.h>
+
+namespace
+{
+    constexpr size_t kAlignment = 16;
+    constexpr size_t kRegionSize = 2 * 1024 * 1024; // a huge page; slab and arena memory comes in these
+    constexpr size_t kMaxSlabSize = 64 * 1024;      // larger blocks are mapped on their own
+    constexpr size_t kPageSize = 4096;
+
+    // Four classes per power of two: 16, 32, 48, 64, 80, 96, 112, 128, 160, ... 64K. The VM's own
+    // page sizes land within 24 bytes of a class.
+    constexpr int kSlabClasses = 44;
+
+    host_allocator::kind s_DefaultKind = host_allocator::kind::system;
+
+    size_t AlignUp(size_t size, size_t alignment)
+    {
+        return (size + alignment - 1) & ~(alignment - 1);
+    }
+
+    int SlabClass(size_t size)
+    {
+        if (size <= 64)
+            return size == 0 ? 0 : int((size - 1) / 16);
+
+        int power = int(std::bit_width(size - 1)) - 1;
+        return 4 + (power - 6) * 4 + int(((size - 1) >> (power - 2)) & 3);
+    }
+
+    size_t SlabClassSize(int sizeclass)
+    {
+        if (sizeclass < 4)
+            return size_t(sizeclass + 1) * 16;
+
+        int power = 6 + (sizeclass - 4) / 4;
+        return (size_t(1) << power) + (size_t((sizeclass - 4) % 4 + 1) << (power - 2));
+    }
+
+    // Anonymous memory; mappings of a huge page or more are aligned to one and marked for huge pages.
+    char* MapMemory(size_t size)
+    {
+        if (size < kRegionSize) {
+            void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            return p == MAP_FAILED ? nullptr : static_cast<char*>(p);
+        }
+
+        size_t span = size + kRegionSize;
+        void* p = mmap(nullptr, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            return nullptr;
+
+        char* raw = static_cast<char*>(p);
+        char* aligned = reinterpret_cast<char*>(AlignUp(reinterpret_cast<uintptr_t>(raw), kRegionSize));
+        if (aligned != raw)
+            munmap(raw, aligned - raw);
+        if (aligned + size != raw + span)
+            munmap(aligned + size, raw + span - (aligned + size));
+
+        madvise(aligned, size, MADV_HUGEPAGE);
+        return aligned;
+    }
+
+    class SystemAllocator : public host_allocator
+    {
+    public:
+        size_t reserved_bytes() const override
+        {
+            return requested_bytes();
+        }
+
+    protected:
+        void* reallocate(void* ptr, size_t, size_t nsize) override
+        {
+            if (nsize == 0) {
+                free(ptr);
+                return nullptr;
+            }
+
+            return realloc(ptr, nsize);
+        }
+    };
+
+    class SlabAllocator : public host_allocator
+    {
+    public:
+        ~SlabAllocator() override
+        {
+            for (char* region : regions)
+                munmap(region, kRegionSize);
+            for (const auto& [block, size] : large)
+                munmap(block, size);
+        }
+
+        size_t reserved_bytes() const override
+        {
+            return regions.size() * kRegionSize + largebytes;
+        }
+
+    protected:
+        void* reallocate(void* ptr, size_t osize, size_t nsize) override
+        {
+            if (!ptr)
+                return nsize == 0 ? nullptr : Allocate(nsize);
+
+            if (nsize == 0) {
+                Free(ptr, osize);
+                return nullptr;
+            }
+
+            if (osize > kMaxSlabSize && nsize > kMaxSlabSize)
+                return Remap(ptr, osize, nsize);
+
+            if (osize <= kMaxSlabSize && nsize <= kMaxSlabSize && SlabClass(osize) == SlabClass(nsize))
+                return ptr;
+
+            void* block = Allocate(nsize);
+            if (!block)
+                return nullptr;
+
+            memcpy(block, ptr, std::min(osize, nsize));
+            Free(ptr, osize);
+            return block;
+        }
+
+    private:
+        struct FreeBlock
+        {
+            FreeBlock* next;
+        };
+
+        FreeBlock* freelists[kSlabClasses] = {};
+        char* cursor = nullptr; // unused tail of the newest region
+        char* limit = nullptr;
+        std::vector<char*> regions;
+
+        std::unordered_map<void*, size_t> large; // block -> mapping size
+        size_t largebytes = 0;
+
+        void* Allocate(size_t size)
+        {
+            if (size > kMaxSlabSize)
+                return MapLarge(size);
+
+            int sizeclass = SlabClass(size);
+            if (FreeBlock* block = freelists[sizeclass]) {
+                freelists[sizeclass] = block->next;
+                return block;
+            }
+
+            size_t blocksize = SlabClassSize(sizeclass);
+            if (size_t(limit - cursor) < blocksize) {
+                char* region = MapMemory(kRegionSize);
+                if (!region)
+                    return nullptr;
+
+                // the old region's tail is too small for this class; give it to the smaller ones
+                for (int c = sizeclass - 1; c >= 0 && cursor != limit; c--) {
+                    while (size_t(limit - cursor) >= SlabClassSize(c)) {
+                        freelists[c] = new (cursor) FreeBlock{freelists[c]};
+                        cursor += SlabClassSize(c);
+                    }
+                }
+
+                regions.push_back(region);
+                cursor = region;
+                limit = region + kRegionSize;
+            }
+
+            void* block = cursor;
+            cursor += blocksize;
+            return block;
+        }
+
+        void Free(void* ptr, size_t size)
+        {
+            if (size > kMaxSlabSize) {
+                auto it = large.find(ptr);
+                largebytes -= it->second;
+                munmap(ptr, it->second);
+                large.erase(it);
+                return;
+            }
+
+            int sizeclass = SlabClass(size);
+            freelists[sizeclass] = new (ptr) FreeBlock{freelists[sizeclass]};
+        }
+
+        void* MapLarge(size_t size)
+        {
+            size_t mapped = AlignUp(size, kPageSize);
+            char* block = MapMemory(mapped);
+            if (!block)
+                return nullptr;
+
+            large.emplace(block, mapped);
+            largebytes += mapped;
+            return block;
+        }
+
+        // Growing arrays and strings keep their pages; mremap moves the mapping if it has to.
+        void* Remap(void* ptr, size_t osize, size_t nsize)
+        {
+            auto it = large.find(ptr);
+            size_t mapped = AlignUp(nsize, kPageSize);
+            if (mapped == it->second)
+                return ptr;
+
+            // crossing into huge page sizes needs the aligned mapping MapMemory makes
+            if (mapped >= kRegionSize && it->second < kRegionSize) {
+                void* block = MapLarge(nsize);
+                if (!block)
+                    return nullptr;
+
+                memcpy(block, ptr, std::min(osize, nsize));
+                Free(ptr, osize);
+                return block;
+            }
+
+            void* block = mremap(ptr, it->second, mapped, MREMAP_MAYMOVE);
+            if (block == MAP_FAILED)
+                return nullptr;
+
+            largebytes += mapped - it->second;
+            large.erase(it);
+            large.emplace(block, mapped);
+            return block;
+        }
+    };
+
+    // Never reuses memory: frees only give back the most recent block, and growing the most recent
+    // block extends it in place.
+    class ArenaAllocator : public host_allocator
+    {
+    public:
+        ~ArenaAllocator() override
+        {
+            for (const auto& [region, size] : regions)
+                munmap(region, size);
+        }
+
+        size_t reserved_bytes() const override
+        {
+            return reserved;
+        }
+
+    protected:
+        void* reallocate(void* ptr, size_t osize, size_t nsize) override
+        {
+            size_t oldsize = AlignUp(osize, kAlignment);
+            size_t newsize = AlignUp(nsize, kAlignment);
+            bool last = ptr && static_cast<char*>(ptr) + oldsize == cursor;
+
+            if (nsize == 0) {
+                if (last)
+                    cursor = static_cast<char*>(ptr);
+                return nullptr;
+            }
+
+            if (ptr) {
+                if (newsize <= oldsize) {
+                    if (last)
+                        cursor = static_cast<char*>(ptr) + newsize;
+                    return ptr;
+                }
+
+                if (last && size_t(limit - static_cast<char*>(ptr)) >= newsize) {
+                    cursor = static_cast<char*>(ptr) + newsize;
+                    return ptr;
+                }
+            }
+
+            if (size_t(limit - cursor) < newsize) {
+                size_t size = std::max(kRegionSize, AlignUp(newsize, kRegionSize));
+                char* region = MapMemory(size);
+                if (!region)
+                    return nullptr;
+
+                regions.emplace_back(region, size);
+                reserved += size;
+                cursor = region;
+                limit = region + size;
+            }
+
+            void* block = cursor;
+            cursor += newsize;
+            if (ptr)
+                memcpy(block, ptr, std::min(osize, nsize));
+            return block;
+        }
+
+    private:
+        char* cursor = nullptr;
+        char* limit = nullptr;
+        std::vector<std::pair<char*, size_t>> regions;
+        size_t reserved = 0;
+    };
+}
+
+bool host_allocator::parse(const char* name, kind& result)
+{
+    for (kind k : {kind::system, kind::slab, kind::arena}) {
+        if (strcmp(name, host_allocator::name(k)) == 0) {
+            result = k;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+const char* host_allocator::name(kind kind)
+{
+    switch (kind) {
+    case kind::system:
+        return "system";
+    case kind::slab:
+        return "slab";
+    case kind::arena:
+        return "arena";
+    }
+
+    return "unknown";
+}
+
+void host_allocator::set_default(kind kind)
+{
+    s_DefaultKind = kind;
+}
+
+host_allocator::kind host_allocator::get_default()
+{
+    return s_DefaultKind;
+}
+
+host_allocator* host_allocator::create(kind kind)
+{
+    switch (kind) {
+    case kind::slab:
+        return new SlabAllocator();
+    case kind::arena:
+        return new ArenaAllocator();
+    case kind::system:
+        break;
+    }
+
+    return new SystemAllocator();
+}
+
+void host_allocator::destroy(host_allocator* allocator)
+{
+    delete allocator;
+}
+
+void* host_allocator::allocate(void* ud, void* ptr, size_t osize, size_t nsize)
+{
+    host_allocator* allocator = static_cast<host_allocator*>(ud);
+    void* block = allocator->reallocate(ptr, osize, nsize);
+
+    if (block || nsize == 0) {
+        allocator->requestedbytes += nsize - (ptr ? osize : 0);
+        allocator->requestedblocks += (ptr == nullptr) - (nsize == 0);
+    }
+
+    return block;
+}
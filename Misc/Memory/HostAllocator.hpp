@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+
+// Where a state's memory comes from. The VM carves objects up to 1KB out of its own pages, so what
+// reaches the host is pages (16KB/32KB) and larger blocks: arrays, long strings, stacks. Each state
+// gets its own allocator, used from one thread at a time, and everything it still holds is released
+// in bulk when the state is closed through environment::close_state.
+//
+// Slabs belong to the state rather than the thread. A worker owns its state, so they are already
+// thread-local in effect and need no locking, and a state's memory never outlives it in a cache
+// shared with the states the thread runs after it.
+//
+//   system  realloc/free from the C library
+//   slab    size-class free lists carved from 2MB huge-page-aligned regions; blocks over 64KB get
+//           mappings of their own (huge pages from 2MB) that grow in place with mremap
+//   arena   bump allocation that never reuses freed memory, for short one-shot scripts
+class host_allocator
+{
+public:
+	enum class kind { system, slab, arena };
+
+	// Parses "system", "slab" or "arena".
+	static bool parse(const char* name, kind& result);
+	static const char* name(kind kind);
+
+	// What create_state uses; SPARK_ALLOCATOR picks it at startup.
+	static void set_default(kind kind);
+	static kind get_default();
+
+	static host_allocator* create(kind kind);
+	static void destroy(host_allocator* allocator);
+
+	// lua_Alloc for lua_newstate, with the allocator as ud.
+	static void* allocate(void* ud, void* ptr, size_t osize, size_t nsize);
+
+	virtual ~host_allocator() = default;
+
+	size_t requested_bytes() const { return requestedbytes; }
+	size_t requested_blocks() const { return requestedblocks; }
+	// Memory taken from the system, including free lists and unused region tails.
+	virtual size_t reserved_bytes() const = 0;
+
+	void* accounting = nullptr; // set by memory_stats::attach while the state is open
+
+protected:
+	virtual void* reallocate(void* ptr, size_t osize, size_t nsize) = 0;
+
+private:
+	size_t requestedbytes = 0;
+	size_t requestedblocks = 0;
+};
@@ -0,0 +1,379 @@
+#include "MemoryStats.hpp"
+#include "HostAllocator.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "lstate.h"
+#include "lobject.h"
+#include "lualib.h"
+
+namespace
+{
+    // Allocation sizes by power of two: <= 16, <= 32, ... <= 512K, then everything larger.
+    constexpr int kSizeClasses = 17;
+
+    // Distinct functions tracked; allocations in any others are charged to "(other)".
+    constexpr size_t kSiteLimit = 4096;
+
+    struct Site
+    {
+        TString* source = nullptr;    // identify the proto, see FindSite
+        TString* debugname = nullptr;
+        int linedefined = 0;
+
+        std::string name;
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+    };
+
+    enum SpecialSite { SiteHost, SiteStack, SiteOther, SpecialSiteCount };
+
+    struct Accounting
+    {
+        global_State* global = nullptr;
+        host_allocator* allocator = nullptr;
+
+        uint64_t allocations[LUA_MEMORY_CATEGORIES] = {};
+        uint64_t allocated[LUA_MEMORY_CATEGORIES] = {};
+        uint64_t histogram[kSizeClasses] = {};
+
+        std::vector<std::string> names{"host"};
+        std::unordered_map<std::string, int> ids{{"host", 0}};
+
+        // released categories, reused once their live bytes are gone; their counts are kept here
+        std::vector<int> released;
+        std::vector<bool> isreleased = std::vector<bool>(LUA_MEMORY_CATEGORIES);
+        std::string finishedname = "(finished jobs)";
+        uint64_t finishedallocations = 0;
+        uint64_t finishedallocated = 0;
+
+        std::unordered_map<Proto*, Site> sites;
+        Proto* lastproto = nullptr; // allocations come in runs from one function; map entries don't move
+        Site* lastsite = nullptr;
+        std::vector<Site> retired; // sites whose proto was freed and its address reused
+        Site special[SpecialSiteCount] = {{nullptr, nullptr, 0, "(host)"}, {nullptr, nullptr, 0, "(stack)"}, {nullptr, nullptr, 0, "(other)"}};
+
+        ~Accounting()
+        {
+            global->cb.onallocate = nullptr;
+            allocator->accounting = nullptr;
+        }
+    };
+
+    char s_AccountingKey;
+
+    Accounting* GetAccounting(lua_State* L)
+    {
+        host_allocator* allocator = static_cast<host_allocator*>(L->global->ud);
+        return allocator ? static_cast<Accounting*>(allocator->accounting) : nullptr;
+    }
+
+    int SizeClass(size_t size)
+    {
+        return size <= 16 ? 0 : std::min(int(std::bit_width(size - 1)) - 4, kSizeClasses - 1);
+    }
+
+    std::string SiteName(Proto* p)
+    {
+        char buffer[LUA_IDSIZE];
+        const char* chunk = luaO_chunkid(buffer, sizeof(buffer), getstr(p->source), p->source->len);
+        return std::string(p->debugname ? getstr(p->debugname) : "anonymous") + " " + chunk + ":" + std::to_string(p->linedefined);
+    }
+
+    Site& FindProtoSite(Accounting* a, Proto* p)
+    {
+        auto it = a->sites.find(p);
+        if (it != a->sites.end())
+        {
+            Site& site = it->second;
+            if (site.source == p->source && site.debugname == p->debugname && site.linedefined == p->linedefined)
+                return site;
+
+            // a freed proto's address was reused; keep what the old one allocated
+            a->retired.push_back(std::move(site));
+            site = Site{p->source, p->debugname, p->linedefined, SiteName(p)};
+            return site;
+        }
+
+        if (a->sites.size() + a->retired.size() >= kSiteLimit)
+            return a->special[SiteOther];
+
+        return a->sites[p] = Site{p->source, p->debugname, p->linedefined, SiteName(p)};
+    }
+
+    // The innermost Luau function on L's stack, which is what C functions allocate on behalf of.
+    Site& FindSite(Accounting* a, lua_State* L, size_t osize)
+    {
+        // resizing the thread's own stack or CallInfo array: until the resize returns, L->ci and the
+        // frames may point into the old arrays, which are already freed
+        if (osize != 0 && (osize == size_t(L->stacksize) * sizeof(TValue) || osize == size_t(L->size_ci) * sizeof(CallInfo)))
+            return a->special[SiteStack];
+
+        Proto* p = nullptr;
+        for (CallInfo* ci = L->ci; ci > L->base_ci; ci--)
+        {
+            if (isLua(ci))
+            {
+                p = ci_func(ci)->l.p;
+                break;
+            }
+        }
+
+        if (!p)
+            return a->special[SiteHost];
+
+        if (p == a->lastproto && a->lastsite->source == p->source && a->lastsite->debugname == p->debugname &&
+            a->lastsite->linedefined == p->linedefined)
+            return *a->lastsite;
+
+        Site& site = FindProtoSite(a, p);
+        a->lastproto = p;
+        a->lastsite = &site;
+        return site;
+    }
+
+    // Only sees allocations and growth; frees are visible through the VM's per-category totals.
+    void OnAllocate(lua_State* L, size_t osize, size_t nsize)
+    {
+        if (nsize == 0)
+            return;
+
+        Accounting* a = GetAccounting(L);
+        uint8_t category = L->activememcat;
+
+        a->allocations[category]++;
+        a->allocated[category] += nsize;
+        a->histogram[SizeClass(nsize)]++;
+
+        Site& site = FindSite(a, L, osize);
+        site.allocations++;
+        site.bytes += nsize;
+    }
+
+    struct CategoryRow
+    {
+        const std::string* name;
+        size_t live;
+        uint64_t allocations;
+        uint64_t allocated;
+    };
+
+    // Copied out before anything is reported, since reporting allocates and so updates the accounting.
+    struct Snapshot
+    {
+        size_t total = 0;
+        size_t systembytes = 0;  // held from the host allocator, including the VM's page slack
+        size_t systemblocks = 0;
+        size_t reservedbytes = 0;
+        std::vector<CategoryRow> categories;
+        uint64_t histogram[kSizeClasses] = {};
+        std::vector<Site> sites;
+    };
+
+    Snapshot TakeSnapshot(lua_State* L, Accounting* a, int sitelimit)
+    {
+        Snapshot s;
+        s.total = lua_totalbytes(L, -1);
+        s.systembytes = a->allocator->requested_bytes();
+        s.systemblocks = a->allocator->requested_blocks();
+        s.reservedbytes = a->allocator->reserved_bytes();
+        std::copy(std::begin(a->histogram), std::end(a->histogram), s.histogram);
+
+        CategoryRow finished = {&a->finishedname, 0, a->finishedallocations, a->finishedallocated};
+        for (size_t i = 0; i < a->names.size(); i++)
+        {
+            size_t live = lua_totalbytes(L, int(i));
+            if (a->isreleased[i])
+                finished.live += live;
+            else if (live != 0 || a->allocations[i] != 0)
+                s.categories.push_back(CategoryRow{&a->names[i], live, a->allocations[i], a->allocated[i]});
+        }
+        if (finished.live != 0 || finished.allocations != 0)
+            s.categories.push_back(finished);
+        std::sort(s.categories.begin(), s.categories.end(), [](const CategoryRow& x, const CategoryRow& y) { return x.live > y.live; });
+
+        std::vector<const Site*> sites;
+        for (const auto& [p, site] : a->sites)
+            sites.push_back(&site);
+        for (const Site& site : a->retired)
+            sites.push_back(&site);
+        for (const Site& site : a->special)
+        {
+            if (site.allocations != 0)
+                sites.push_back(&site);
+        }
+
+        size_t count = std::min(sites.size(), size_t(std::max(sitelimit, 0)));
+        std::partial_sort(sites.begin(), sites.begin() + count, sites.end(), [](const Site* x, const Site* y) { return x->bytes > y->bytes; });
+        for (size_t i = 0; i < count; i++)
+            s.sites.push_back(*sites[i]);
+
+        return s;
+    }
+
+    void SetNumber(lua_State* L, const char* key, double value)
+    {
+        lua_pushnumber(L, value);
+        lua_setfield(L, -2, key);
+    }
+
+    double SizeClassLimit(int sizeclass)
+    {
+        return sizeclass == kSizeClasses - 1 ? HUGE_VAL : double(size_t(16) << sizeclass);
+    }
+}
+
+void memory_stats::attach(lua_State* L)
+{
+    lua_pushlightuserdata(L, &s_AccountingKey);
+    void* storage = lua_newuserdatadtor(L, sizeof(Accounting), [](void* p) { static_cast<Accounting*>(p)->~Accounting(); });
+    Accounting* a = new (storage) Accounting();
+    lua_rawset(L, LUA_REGISTRYINDEX);
+
+    a->global = L->global;
+    a->allocator = static_cast<host_allocator*>(L->global->ud);
+    a->allocator->accounting = a;
+    lua_callbacks(L)->onallocate = OnAllocate;
+}
+
+int memory_stats::category(lua_State* L, const char* name)
+{
+    Accounting* a = GetAccounting(L);
+    if (!a)
+        return 0;
+
+    auto it = a->ids.find(name);
+    if (it != a->ids.end())
+        return it->second;
+
+    for (size_t i = 0; i < a->released.size(); i++) {
+        int id = a->released[i];
+        if (lua_totalbytes(L, id) != 0)
+            continue;
+
+        a->released[i] = a->released.back();
+        a->released.pop_back();
+        a->isreleased[id] = false;
+        a->names[id] = name;
+        a->ids.emplace(name, id);
+        return id;
+    }
+
+    if (a->names.size() == LUA_MEMORY_CATEGORIES - 1)
+        a->names.push_back("(other)");
+    if (a->names.size() == LUA_MEMORY_CATEGORIES)
+        return LUA_MEMORY_CATEGORIES - 1;
+
+    int id = int(a->names.size());
+    a->names.push_back(name);
+    a->ids.emplace(name, id);
+    return id;
+}
+
+void memory_stats::release(lua_State* L, int category)
+{
+    Accounting* a = GetAccounting(L);
+    if (!a || category <= 0 || size_t(category) >= a->names.size() || category == LUA_MEMORY_CATEGORIES - 1 || a->isreleased[category])
+        return;
+
+    a->finishedallocations += a->allocations[category];
+    a->finishedallocated += a->allocated[category];
+    a->allocations[category] = 0;
+    a->allocated[category] = 0;
+
+    a->ids.erase(a->names[category]);
+    a->names[category].clear();
+    a->isreleased[category] = true;
+    a->released.push_back(category);
+}
+
+void memory_stats::push(lua_State* L, int sites)
+{
+    Accounting* a = GetAccounting(L);
+    if (!a) {
+        lua_pushnil(L);
+        return;
+    }
+
+    Snapshot s = TakeSnapshot(L, a, sites);
+
+    lua_createtable(L, 0, 7);
+    SetNumber(L, "total", double(s.total));
+    SetNumber(L, "system", double(s.systembytes));
+    SetNumber(L, "systemblocks", double(s.systemblocks));
+    SetNumber(L, "reserved", double(s.reservedbytes));
+
+    lua_createtable(L, int(s.categories.size()), 0);
+    for (size_t i = 0; i < s.categories.size(); i++) {
+        const CategoryRow& row = s.categories[i];
+        lua_createtable(L, 0, 4);
+        lua_pushlstring(L, row.name->data(), row.name->size());
+        lua_setfield(L, -2, "name");
+        SetNumber(L, "live", double(row.live));
+        SetNumber(L, "allocations", double(row.allocations));
+        SetNumber(L, "allocated", double(row.allocated));
+        lua_rawseti(L, -2, int(i + 1));
+    }
+    lua_setfield(L, -2, "categories");
+
+    lua_createtable(L, kSizeClasses, 0);
+    for (int i = 0; i < kSizeClasses; i++) {
+        lua_createtable(L, 0, 2);
+        SetNumber(L, "size", SizeClassLimit(i));
+        SetNumber(L, "count", double(s.histogram[i]));
+        lua_rawseti(L, -2, i + 1);
+    }
+    lua_setfield(L, -2, "histogram");
+
+    lua_createtable(L, int(s.sites.size()), 0);
+    for (size_t i = 0; i < s.sites.size(); i++) {
+        const Site& site = s.sites[i];
+        lua_createtable(L, 0, 3);
+        lua_pushlstring(L, site.name.data(), site.name.size());
+        lua_setfield(L, -2, "name");
+        SetNumber(L, "allocations", double(site.allocations));
+        SetNumber(L, "bytes", double(site.bytes));
+        lua_rawseti(L, -2, int(i + 1));
+    }
+    lua_setfield(L, -2, "sites");
+}
+
+void memory_stats::print(lua_State* L, std::ostream& out, int sites)
+{
+    Accounting* a = GetAccounting(L);
+    if (!a)
+        return;
+
+    Snapshot s = TakeSnapshot(L, a, sites);
+
+    char line[256];
+    std::snprintf(line, sizeof(line), "%zu bytes live, %zu bytes in %zu blocks from the host allocator, %zu bytes reserved", s.total,
+        s.systembytes, s.systemblocks, s.reservedbytes);
+    out << "----MEMORY----" << std::endl << line << std::endl;
+
+    for (const CategoryRow& row : s.categories) {
+        std::snprintf(line, sizeof(line), "%-32s %12zu live %12llu allocations %14llu allocated", row.name->c_str(), row.live,
+            (unsigned long long)row.allocations, (unsigned long long)row.allocated);
+        out << line << std::endl;
+    }
+
+    std::string sizes = "sizes:";
+    for (int i = 0; i < kSizeClasses; i++) {
+        if (s.histogram[i] != 0)
+            sizes += (i == kSizeClasses - 1 ? std::string(" more: ") : " <=" + std::to_string(size_t(SizeClassLimit(i))) + ": ") + std::to_string(s.histogram[i]);
+    }
+    out << sizes << std::endl;
+
+    for (const Site& site : s.sites) {
+        std::snprintf(line, sizeof(line), "%-48s %12llu allocations %14llu bytes", site.name.c_str(), (unsigned long long)site.allocations,
+            (unsigned long long)site.bytes);
+        out << line << std::endl;
+    }
+}
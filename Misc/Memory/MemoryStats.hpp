@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <ostream>
+
+#include "lua.h"
+
+// Allocation accounting for a Luau state. Live bytes per memory category come from the VM; the
+// onallocate callback adds allocation counts and sizes per category, a size histogram, and the
+// Luau function each allocation was made under. Categories are named by the host (one per
+// environment library and one per loaded chunk name); a thread allocates into the category it runs
+// under, see lua_setmemcat.
+class memory_stats
+{
+public:
+	// Creates the accounting for L's state, owned by its registry, and starts recording. The state
+	// must allocate through a host_allocator.
+	static void attach(lua_State* L);
+
+	// The category for name, assigned on first use. Names past LUA_MEMORY_CATEGORIES share one
+	// category; without accounting everything is category 0.
+	static int category(lua_State* L, const char* name);
+	// Gives back a category whose owner is done with it, such as a finished job's. What it counted
+	// moves to one "(finished jobs)" row, and the id goes to a later name once nothing allocated
+	// under it is alive, so a long batch never runs out of categories.
+	static void release(lua_State* L, int category);
+
+	// Pushes the table memstats() returns, listing the top `sites` allocating functions.
+	static void push(lua_State* L, int sites);
+	static void print(lua_State* L, std::ostream& out, int sites);
+};
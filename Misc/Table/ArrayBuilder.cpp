@@ -0,0 +1,54 @@
+#include "ArrayBuilder.hpp"
+
+#include "lapi.h"
+#include "lgc.h"
+#include "lstate.h"
+#include "ltable.h"
+
+array_builder::array_builder(lua_State* L, int capacity)
+    : L(L)
+{
+    lua_createtable(L, capacity, 0);
+    table = hvalue(L->top - 1);
+}
+
+TValue* array_builder::next_slot()
+{
+    // past the presized part this is an ordinary (slower) table store
+    if (count < table->sizearray)
+        return &table->array[count++];
+
+    return luaH_setnum(L, table, ++count);
+}
+
+void array_builder::append(const TValue* value)
+{
+    TValue* slot = next_slot();
+    setobj2t(L, slot, value);
+    luaC_barriert(L, table, value);
+}
+
+void array_builder::append(GCObject* object)
+{
+    TValue value;
+    value.value.gc = object;
+    value.tt = object->gch.tt;
+    append(&value);
+}
+
+void array_builder::append_nil()
+{
+    setnilvalue(next_slot());
+}
+
+void array_builder::push_objects(lua_State* L, const std::vector<GCObject*>& objects)
+{
+    const size_t threshold = L->global->GCthreshold;
+    L->global->GCthreshold = SIZE_MAX;
+
+    array_builder array(L, int(objects.size()));
+    for (GCObject* object : objects)
+        array.append(object);
+
+    L->global->GCthreshold = threshold;
+}
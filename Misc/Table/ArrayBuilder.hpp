@@ -0,0 +1,32 @@
+#pragma once
+#include <vector>
+
+#include "lua.h"
+#include "lobject.h"
+
+// Builds a result array whose length is known up front: the table is created with that many array
+// slots and values are written straight into them, instead of a lua_rawseti per element that grows
+// (and rehashes) the table as it goes.
+class array_builder
+{
+public:
+	// Pushes the new table.
+	array_builder(lua_State* L, int capacity);
+
+	void append(const TValue* value);
+	void append(GCObject* object);
+	void append_nil();
+
+	int size() const { return count; }
+
+	// Pushes an array of objects the caller found by walking the heap. They are only referenced from
+	// C until they are in the table, so the collector is held off while it is built.
+	static void push_objects(lua_State* L, const std::vector<GCObject*>& objects);
+
+private:
+	TValue* next_slot();
+
+	lua_State* L;
+	LuaTable* table;
+	int count = 0;
+};
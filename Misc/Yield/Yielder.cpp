@@ -1,131 +1,158 @@
-//#include "Yielder.hpp"
-
-
 #include "Yielder.hpp"
-#include <coroutine>
-#include <functional>
+#include "../Env/Task/Task.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <stdexcept>
+#include <vector>
 
-// The promise type for the coroutine
-struct LuaYieldPromise
+#include <pthread.h>
+
+namespace
 {
-    // A function pointer to the coroutine's final result.
-    int result_count = 0;
-    lua_State* state;
+    // Bounded so a burst of calls queues up instead of spawning a thread per call.
+    constexpr size_t MaxWorkers = 8;
 
-    // The coroutine's return type.
-    struct CoroutineHandle
+    class WorkerPool
     {
-        std::coroutine_handle<LuaYieldPromise> handle;
+    public:
+        explicit WorkerPool(size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+                workers.emplace_back([this] { Work(); });
+        }
+
+        ~WorkerPool()
+        {
+            {
+                std::lock_guard lock(mutex);
+                stopping = true;
+            }
+            ready.notify_all();
+
+            for (std::thread& worker : workers)
+                worker.join();
+        }
+
+        void Submit(std::function<void()> job)
+        {
+            {
+                std::lock_guard lock(mutex);
+                jobs.push_back(std::move(job));
+            }
+            ready.notify_one();
+        }
+
+        size_t Size() const
+        {
+            return workers.size();
+        }
+
+    private:
+        void Work()
+        {
+            for (;;)
+            {
+                std::function<void()> job;
+                {
+                    std::unique_lock lock(mutex);
+                    ready.wait(lock, [this] { return stopping || !jobs.empty(); });
+
+                    // queued jobs still finish so their completions get posted
+                    if (jobs.empty())
+                        return;
+
+                    job = std::move(jobs.front());
+                    jobs.pop_front();
+                }
+
+                job();
+            }
+        }
+
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::deque<std::function<void()>> jobs;
+        bool stopping = false;
+        std::vector<std::thread> workers;
     };
 
-    auto get_return_object()
-    {
-        return CoroutineHandle{std::coroutine_handle<LuaYieldPromise>::from_promise(*this)};
-    }
-
-    // This is where the magic happens. The coroutine immediately suspends on creation.
-    std::suspend_always initial_suspend()
-    {
-        return {};
-    }
+    // A child forked from a process that already started the pool (worker_host's fork mode) inherits
+    // the pool's memory but none of its threads, and maybe a mutex one of them held. The child drops
+    // it untouched, leaking one object, and starts its own pool on first use.
+    std::atomic<WorkerPool*> s_Pool{nullptr};
 
-    // The final result. The coroutine will not be resumed after this point.
-    std::suspend_always final_suspend() noexcept
+    struct PoolOwner
     {
-        return {};
-    }
+        ~PoolOwner()
+        {
+            delete s_Pool.load();
+        }
+    } s_PoolOwner;
 
-    // Sets the final return value of the coroutine.
-    void return_value(int value)
+    WorkerPool& GetPool()
     {
-        result_count = value;
-    }
+        static const int forkhandler = pthread_atfork(nullptr, nullptr, [] { s_Pool.store(nullptr); });
+        (void)forkhandler;
 
-    // Required by the C++ coroutine standard.
-    void unhandled_exception() {}
-};
+        WorkerPool* pool = s_Pool.load();
+        if (pool)
+            return *pool;
 
-// Add this specialization to link your CoroutineHandle to the promise type.
-template <typename... Args>
-struct std::coroutine_traits<LuaYieldPromise::CoroutineHandle, Args...>
-{
-    using promise_type = LuaYieldPromise;
-};
+        WorkerPool* created = new WorkerPool(std::clamp<size_t>(std::thread::hardware_concurrency(), 1, MaxWorkers));
+        if (!s_Pool.compare_exchange_strong(pool, created)) {
+            delete created; // another thread got there first
+            return *pool;
+        }
 
-// The coroutine's body, which replaces the 'thread_worker' function.
-LuaYieldPromise::CoroutineHandle
-thread_worker(lua_State* L, const std::function<yielder::yield_return()>& generator)
-{
-    // Call the generator and return its result, which becomes the coroutine's return value.
-    co_return generator()(L);
+        return *created;
+    }
 }
 
 int yielder::yield_execution(lua_State* L, const std::function<yield_return()>& generator)
 {
-    // Create the coroutine and get its handle.
-    auto coro_handle = thread_worker(L, generator);
-
-    // The coroutine is suspended at its initial point.
-    // We can now pass control back to Lua.
-    L->base = L->top;
-    L->status = LUA_YIELD;
-    L->ci->flags |= 1;
-    return -1;
+    if (!lua_isyieldable(L))
+        luaL_error(L, "attempt to yield across metamethod/C-call boundary");
+
+    // the scheduler holds a ref on the thread until the completion has run, so the collector
+    // can't free it while the worker is busy; the worker itself never sees a Luau object
+    task_scheduler::ticket ticket = task_scheduler::park_external(L);
+
+    GetPool().Submit([ticket, generator] {
+        yield_return done;
+
+        try
+        {
+            done = generator();
+        }
+        catch (const std::exception& e)
+        {
+            done = [message = std::string(e.what())](lua_State* L) {
+                lua_pushlstring(L, message.data(), message.size());
+                return -1;
+            };
+        }
+        catch (...)
+        {
+            done = [](lua_State* L) {
+                lua_pushliteral(L, "native task failed");
+                return -1;
+            };
+        }
+
+        if (!done)
+            done = [](lua_State*) { return 0; };
+
+        task_scheduler::complete(ticket, std::move(done));
+    });
+
+    return lua_yield(L, 0);
 }
 
-
-/*
-struct task_data
+size_t yielder::pool_size()
 {
-	lua_State* state;
-	std::function<yielder::yield_return()> generator;
-	PTP_WORK work;
-};
-
-void thread_worker(task_data* data)
-{
-	try
-	{
-		auto yield_result = data->generator();
-		int result_count = yield_result(data->state);
-
-		lua_State* thread_ctx = lua_newthread(data->state);
-
-		lua_getglobal(thread_ctx, "task");
-		lua_getfield(thread_ctx, -1, "defer");
-		lua_pushthread(data->state);
-		lua_xmove(data->state, thread_ctx, 1);
-		lua_pop(data->state, 1);
-
-		for (int i = result_count; i >= 1; --i)
-		{
-			lua_pushvalue(data->state, -i);
-			lua_xmove(data->state, thread_ctx, 1);
-		}
-
-		lua_pcall(thread_ctx, result_count + 1, 0, 0);
-		lua_settop(thread_ctx, 0);
-	}
-	catch (...)
-	{
-	}
-
-	delete data;
+    return GetPool().Size();
 }
-
-int yielder::yield_execution(lua_State* L, const std::function<yield_return()>& generator)
-{
-	lua_pushthread(L);
-	lua_ref(L, -1);
-	lua_pop(L, 1);
-
-	auto* task = new task_data{ L, generator, nullptr };
-
-	std::thread(thread_worker, task).detach();
-
-	L->base = L->top;
-	L->status = LUA_YIELD;
-	L->ci->flags |= 1;
-	return -1;
-}*/
\ No newline at end of file
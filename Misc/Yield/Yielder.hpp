@@ -3,10 +3,21 @@
 #include <thread>
 #include "functional"
 #include "lua.h"
+
+// Offloads blocking native work (file reads, compression, hashing) to a small fixed worker pool
+// so the interpreter loop keeps running task work meanwhile.
 class yielder
 {
 public:
+	// Runs on the VM thread once the work is done: pushes the values the yielded thread resumes
+	// with and returns their count, or pushes an error object and returns -1 to raise it instead.
 	using yield_return = std::function<int(lua_State* L)>;
 
+	// Call as `return yielder::yield_execution(L, ...)` from a native function. generator runs on a
+	// worker thread and must not touch L or any other Luau object; copy what it needs out of the
+	// stack first. An exception thrown by generator is raised in the thread as an error.
 	static int yield_execution(lua_State* L, const std::function<yield_return()>& generator);
-};
\ No newline at end of file
+
+	// Worker count, fixed when the pool starts on first use.
+	static size_t pool_size();
+};